@@ -0,0 +1,145 @@
+#include "CFSQueue.h"
+
+/**
+ * CFSQueue constructor - creates an empty queue
+ * @param capacity - the maximal number of threads in the queue
+ */
+CFSQueue::CFSQueue(int capacity) : _heap(new Thread *[capacity]), _size(0), _minVruntime(0)
+{}
+
+/**
+ * CFSQueue destructor - releases the heap
+ */
+CFSQueue::~CFSQueue()
+{
+    delete[] _heap;
+}
+
+/**
+ * @return true if the queue has no threads, false otherwise
+ */
+bool CFSQueue::empty() const
+{
+    return _size == 0;
+}
+
+/**
+ * add a thread, raising its virtual runtime to the smallest one of the queue if it is below it
+ * @param thread - the thread to add
+ */
+void CFSQueue::pushBack(Thread *thread)
+{
+    if (thread->_vruntime < _minVruntime)
+    {
+        thread->_vruntime = _minVruntime;
+    }
+    place(_size++, thread);
+    siftUp(thread->_readyIndex);
+}
+
+/**
+ * remove the thread with the smallest virtual runtime
+ * @return the removed thread, nullptr if the queue is empty
+ */
+Thread *CFSQueue::popFront()
+{
+    if (_size == 0)
+    {
+        return nullptr;
+    }
+    Thread *first = _heap[0];
+    // the smallest virtual runtime only grows, since the running threads only add to theirs
+    _minVruntime = first->_vruntime > _minVruntime ? first->_vruntime : _minVruntime;
+    remove(first);
+    return first;
+}
+
+/**
+ * remove a thread from the queue
+ * @param thread - the thread to remove, must be in this queue
+ */
+void CFSQueue::remove(Thread *thread)
+{
+    int index = thread->_readyIndex;
+    thread->_readyIndex = -1;
+    Thread *last = _heap[--_size];
+    if (index == _size)
+    {
+        return;
+    }
+    place(index, last);
+    if (index > 0 && last->_vruntime < _heap[(index - 1) / 2]->_vruntime)
+    {
+        siftUp(index);
+    }
+    else
+    {
+        siftDown(index);
+    }
+}
+
+/**
+ * remove all the threads in the queue
+ */
+void CFSQueue::clear()
+{
+    for (int i = 0; i < _size; ++i)
+    {
+        _heap[i]->_readyIndex = -1;
+    }
+    _size = 0;
+}
+
+/**
+ * put a thread at an index of the heap and store the index in it
+ * @param index - the index
+ * @param thread - the thread
+ */
+void CFSQueue::place(int index, Thread *thread)
+{
+    _heap[index] = thread;
+    thread->_readyIndex = index;
+}
+
+/**
+ * move the thread at an index up until its parent ran less than it
+ * @param index - the index of the thread
+ */
+void CFSQueue::siftUp(int index)
+{
+    Thread *thread = _heap[index];
+    while (index > 0 && thread->_vruntime < _heap[(index - 1) / 2]->_vruntime)
+    {
+        place(index, _heap[(index - 1) / 2]);
+        index = (index - 1) / 2;
+    }
+    place(index, thread);
+}
+
+/**
+ * move the thread at an index down until its children ran more than it
+ * @param index - the index of the thread
+ */
+void CFSQueue::siftDown(int index)
+{
+    Thread *thread = _heap[index];
+    for (;;)
+    {
+        int child = 2 * index + 1;
+        if (child >= _size)
+        {
+            break;
+        }
+        if (child + 1 < _size && _heap[child + 1]->_vruntime < _heap[child]->_vruntime)
+        {
+            child++;
+        }
+        if (_heap[child]->_vruntime >= thread->_vruntime)
+        {
+            break;
+        }
+        place(index, _heap[child]);
+        index = child;
+    }
+    place(index, thread);
+}
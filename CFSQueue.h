@@ -0,0 +1,86 @@
+#ifndef CFS_QUEUE_H
+#define CFS_QUEUE_H
+
+#include <stdint.h>
+#include "ReadyQueue.h"
+
+/**
+ * completely fair ready structure - a binary min-heap of threads keyed by their virtual runtime,
+ * so the next thread to run is the one that ran the least, its running time divided by the weight
+ * of its priority. a higher priority gets a larger share of the CPU instead of always running
+ * first. every thread keeps its index in the heap, so any thread is removed in O(log n), and the
+ * heap is an array of a fixed capacity, so no operation allocates memory.
+ * a thread that is added with a virtual runtime below the smallest one the queue has seen is
+ * moved up to it, so threads that were spawned, slept or came from another worker do not run
+ * alone until they catch up.
+ */
+class CFSQueue : public ReadyQueue
+{
+public:
+
+/**
+ * CFSQueue constructor - creates an empty queue
+ * @param capacity - the maximal number of threads in the queue
+ */
+    explicit CFSQueue(int capacity);
+
+/**
+ * CFSQueue destructor - releases the heap
+ */
+    ~CFSQueue() override;
+
+/**
+ * @return true if the queue has no threads, false otherwise
+ */
+    bool empty() const override;
+
+/**
+ * add a thread, raising its virtual runtime to the smallest one of the queue if it is below it
+ * @param thread - the thread to add
+ */
+    void pushBack(Thread *thread) override;
+
+/**
+ * remove the thread with the smallest virtual runtime
+ * @return the removed thread, nullptr if the queue is empty
+ */
+    Thread *popFront() override;
+
+/**
+ * remove a thread from the queue
+ * @param thread - the thread to remove, must be in this queue
+ */
+    void remove(Thread *thread) override;
+
+/**
+ * remove all the threads in the queue
+ */
+    void clear() override;
+
+private:
+
+/**
+ * put a thread at an index of the heap and store the index in it
+ * @param index - the index
+ * @param thread - the thread
+ */
+    void place(int index, Thread *thread);
+
+/**
+ * move the thread at an index up until its parent ran less than it
+ * @param index - the index of the thread
+ */
+    void siftUp(int index);
+
+/**
+ * move the thread at an index down until its children ran more than it
+ * @param index - the index of the thread
+ */
+    void siftDown(int index);
+
+    Thread **_heap;
+    int _size;
+    uint64_t _minVruntime;
+};
+
+#endif
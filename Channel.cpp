@@ -0,0 +1,101 @@
+#include "Channel.h"
+
+/**
+ * Channel constructor - creates an empty open channel
+ * @param capacity - the number of items the buffer holds, rounded up to a power of two, between
+ * 0 and MAX_CHANNEL_CAPACITY
+ */
+Channel::Channel(int capacity) : _buffer(nullptr), _capacity(0), _mask(0), _head(0), _tail(0),
+                                 _closed(false)
+{
+    if (capacity > 0)
+    {
+        _capacity = 1;
+        while (_capacity < (uint32_t) capacity)
+        {
+            _capacity <<= 1;
+        }
+        _mask = _capacity - 1;
+        _buffer = new void *[_capacity];
+    }
+}
+
+/**
+ * Channel destructor - releases the buffer
+ */
+Channel::~Channel()
+{
+    _senders.clear();
+    _receivers.clear();
+    delete[] _buffer;
+}
+
+/**
+ * @return true if the buffer has no items, false otherwise
+ */
+bool Channel::empty() const
+{
+    return _tail == _head;
+}
+
+/**
+ * @return true if the buffer has no room for another item, false otherwise
+ */
+bool Channel::full() const
+{
+    // the positions only grow and wrap around together, so their difference is the item count
+    return _tail - _head == _capacity;
+}
+
+/**
+ * add an item to the end of the buffer
+ * @param item - the item, the buffer must not be full
+ */
+void Channel::push(void *item)
+{
+    _buffer[_tail & _mask] = item;
+    _tail++;
+}
+
+/**
+ * remove the first item of the buffer
+ * @return the item, the buffer must not be empty
+ */
+void *Channel::pop()
+{
+    void *item = _buffer[_head & _mask];
+    _head++;
+    return item;
+}
+
+/**
+ * @return the threads that wait to send to the channel
+ */
+ThreadQueue *Channel::getSenders()
+{
+    return &_senders;
+}
+
+/**
+ * @return the threads that wait to receive from the channel
+ */
+ThreadQueue *Channel::getReceivers()
+{
+    return &_receivers;
+}
+
+/**
+ * @return true if the channel was closed, false otherwise
+ */
+bool Channel::isClosed() const
+{
+    return _closed;
+}
+
+/**
+ * close the channel, after which no item can be sent to it
+ */
+void Channel::close()
+{
+    _closed = true;
+}
@@ -0,0 +1,86 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <stdint.h>
+#include "Thread.h"
+#include "ThreadQueue.h"
+
+#define MAX_CHANNEL_CAPACITY (1 << 24)
+
+/**
+ * channel of pointers between threads: a ring buffer of a fixed power of two capacity and the
+ * queues of the threads that wait to send to it or receive from it. a channel of capacity 0 has
+ * no buffer, so every item is handed from a sender to a receiver. the blocking is done by the
+ * library, the channel only keeps the state. all the operations except the constructor never
+ * allocate memory.
+ */
+class Channel
+{
+public:
+
+/**
+ * Channel constructor - creates an empty open channel
+ * @param capacity - the number of items the buffer holds, rounded up to a power of two, between
+ * 0 and MAX_CHANNEL_CAPACITY
+ */
+    explicit Channel(int capacity);
+
+/**
+ * Channel destructor - releases the buffer
+ */
+    ~Channel();
+
+/**
+ * @return true if the buffer has no items, false otherwise
+ */
+    bool empty() const;
+
+/**
+ * @return true if the buffer has no room for another item, false otherwise
+ */
+    bool full() const;
+
+/**
+ * add an item to the end of the buffer
+ * @param item - the item, the buffer must not be full
+ */
+    void push(void *item);
+
+/**
+ * remove the first item of the buffer
+ * @return the item, the buffer must not be empty
+ */
+    void *pop();
+
+/**
+ * @return the threads that wait to send to the channel
+ */
+    ThreadQueue *getSenders();
+
+/**
+ * @return the threads that wait to receive from the channel
+ */
+    ThreadQueue *getReceivers();
+
+/**
+ * @return true if the channel was closed, false otherwise
+ */
+    bool isClosed() const;
+
+/**
+ * close the channel, after which no item can be sent to it
+ */
+    void close();
+
+private:
+    void **_buffer;
+    uint32_t _capacity;
+    uint32_t _mask;
+    uint32_t _head;
+    uint32_t _tail;
+    bool _closed;
+    ThreadQueue _senders;
+    ThreadQueue _receivers;
+};
+
+#endif
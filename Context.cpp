@@ -0,0 +1,117 @@
+#include "Context.h"
+#include <stdint.h>
+
+#ifdef __x86_64__
+/* ~~~~~~~~ code for 64 bit Intel arch ~~~~~~~~*/
+
+#define INIT_MXCSR 0x1F80 /* default SSE control word: all exceptions masked, round to nearest */
+#define INIT_FPUCW 0x037F /* default x87 control word */
+
+/*
+ * the System V ABI makes rbx, rbp, r12-r15 and the control bits of mxcsr and of the x87 control
+ * word callee-saved. they are pushed on the stack of the current thread, its stack pointer is
+ * saved in from->sp and the same frame is popped from the stack of the next thread.
+ */
+asm(".text\n"
+    ".globl contextSwitch\n"
+    ".type contextSwitch, @function\n"
+    "contextSwitch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq (%rsi), %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size contextSwitch, .-contextSwitch\n");
+
+/**
+ * prepare a context that starts running entry on the given stack the first time it is switched to.
+ * the stack is laid out as if contextSwitch had been called from a function that called entry.
+ * @param ctx - the context to prepare
+ * @param stack - the lowest address of the stack
+ * @param stackSize - the size of the stack in bytes
+ * @param entry - the function the context starts in
+ */
+void contextInit(Context *ctx, char *stack, size_t stackSize, void (*entry)(void))
+{
+    uint64_t *top = (uint64_t *) (((uintptr_t) stack + stackSize) & ~(uintptr_t) 15);
+    // entry starts with rsp = 8 (mod 16), as if it was called, and has no return address
+    *--top = 0;
+    *--top = (uint64_t) entry;
+    for (int i = 0; i < 6; ++i)     // rbp, rbx, r12-r15
+    {
+        *--top = 0;
+    }
+    *--top = (uint64_t) INIT_FPUCW << 32 | INIT_MXCSR;
+    ctx->sp = top;
+}
+
+#else
+/* ~~~~~~~~ fallback for other archs (32 bit Intel) ~~~~~~~~*/
+
+typedef unsigned int address_t;
+#define JB_SP 4
+#define JB_PC 5
+
+
+/**
+ * A translation is required when using an address of a variable.
+   Use this as a black box in your code.
+ */
+static address_t translate_address(address_t addr)
+{
+    address_t ret;
+    asm volatile("xor    %%gs:0x18,%0\n"
+        "rol    $0x9,%0\n"
+                 : "=g" (ret)
+                 : "0" (addr));
+    return ret;
+}
+
+/**
+ * prepare a context that starts running entry on the given stack the first time it is switched to
+ * @param ctx - the context to prepare
+ * @param stack - the lowest address of the stack
+ * @param stackSize - the size of the stack in bytes
+ * @param entry - the function the context starts in
+ */
+void contextInit(Context *ctx, char *stack, size_t stackSize, void (*entry)(void))
+{
+    address_t sp, pc;
+    sp = (address_t) stack + stackSize - sizeof(address_t);
+    pc = (address_t) entry;
+    sigsetjmp(ctx->env, 0);
+    (ctx->env->__jmpbuf)[JB_SP] = translate_address(sp);
+    (ctx->env->__jmpbuf)[JB_PC] = translate_address(pc);
+}
+
+/**
+ * save the current execution state in from and continue from the state saved in to. the signal
+ * mask is neither saved nor restored, so no system call is made.
+ * @param from - where to save the state of the caller
+ * @param to - the state to continue from
+ */
+extern "C" void contextSwitch(Context *from, Context *to)
+{
+    if (sigsetjmp(from->env, 0) == 0)
+    {
+        siglongjmp(to->env, 1);
+    }
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <stddef.h>
+
+#ifndef __x86_64__
+#include <setjmp.h>
+#endif
+
+/**
+ * saved execution state of a thread that is not running.
+ * on x86-64 only the stack pointer is kept here - contextSwitch pushes the callee-saved registers
+ * on the stack of the thread it switches from. other architectures fall back to sigsetjmp /
+ * siglongjmp without saving the signal mask.
+ * switching never touches the signal mask, the caller is responsible for it.
+ */
+struct Context
+{
+#ifdef __x86_64__
+    void *sp;
+#else
+    sigjmp_buf env;
+#endif
+};
+
+/**
+ * prepare a context that starts running entry on the given stack the first time it is switched to.
+ * entry must never return.
+ * @param ctx - the context to prepare
+ * @param stack - the lowest address of the stack
+ * @param stackSize - the size of the stack in bytes
+ * @param entry - the function the context starts in
+ */
+void contextInit(Context *ctx, char *stack, size_t stackSize, void (*entry)(void));
+
+/**
+ * save the current execution state in from and continue from the state saved in to. returns
+ * when some other thread switches back to from.
+ * @param from - where to save the state of the caller
+ * @param to - the state to continue from
+ */
+extern "C" void contextSwitch(Context *from, Context *to);
+
+#endif
@@ -0,0 +1,46 @@
+#include "CycleClock.h"
+
+#define FRACTION_BITS 32
+
+uint64_t CycleClock::_nsecsPerTick = (uint64_t) 1 << FRACTION_BITS;
+
+/**
+ * @return the current time of CLOCK_MONOTONIC in nano-seconds
+ */
+static uint64_t monotonicNsecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * measure the rate of the ticks. called once before the clock is used, it takes
+ * CLOCK_CALIBRATION_NSECS on x86-64
+ */
+void CycleClock::calibrate()
+{
+#ifdef __x86_64__
+    uint64_t startNsecs = monotonicNsecs();
+    uint64_t startTicks = now();
+    uint64_t nsecs;
+    do
+    {
+        nsecs = monotonicNsecs() - startNsecs;
+    } while (nsecs < CLOCK_CALIBRATION_NSECS);
+    uint64_t ticks = now() - startTicks;
+    if (ticks != 0)
+    {
+        _nsecsPerTick = (nsecs << FRACTION_BITS) / ticks;
+    }
+#endif
+}
+
+/**
+ * @param ticks - a number of ticks
+ * @return the same time in nano-seconds
+ */
+uint64_t CycleClock::toNsecs(uint64_t ticks)
+{
+    return (uint64_t) (((unsigned __int128) ticks * _nsecsPerTick) >> FRACTION_BITS);
+}
@@ -0,0 +1,54 @@
+#ifndef CYCLE_CLOCK_H
+#define CYCLE_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __x86_64__
+#include <x86intrin.h>
+#endif
+
+#define CLOCK_CALIBRATION_NSECS 1000000 /* how long calibrate() compares the clocks */
+
+/**
+ * cheap timestamps for the statistics of the threads. on x86-64 a tick is a cycle of the time
+ * stamp counter, which takes a single instruction to read and is assumed to be invariant and
+ * synchronized between the cores, as it is on every x86-64 processor of the last decade. it is
+ * converted to nano-seconds with a rate measured against CLOCK_MONOTONIC by calibrate(). other
+ * architectures use CLOCK_MONOTONIC itself, in nano-seconds.
+ */
+class CycleClock
+{
+public:
+
+/**
+ * measure the rate of the ticks. called once before the clock is used, it takes
+ * CLOCK_CALIBRATION_NSECS on x86-64
+ */
+    static void calibrate();
+
+/**
+ * @return the current tick. inline, since it is read on every change of the state of a thread
+ */
+    static inline uint64_t now()
+    {
+#ifdef __x86_64__
+        return __rdtsc();
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+    }
+
+/**
+ * @param ticks - a number of ticks
+ * @return the same time in nano-seconds
+ */
+    static uint64_t toNsecs(uint64_t ticks);
+
+private:
+    static uint64_t _nsecsPerTick; /* fixed point, 32 bits of fraction */
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "IDAllocator.h"
+
+#define WORD_BIT(index) ((uint64_t) 1 << ((index) % ID_WORD_BITS))
+
+/**
+ * IDAllocator constructor - creates a set in which all the IDs are free
+ * @param capacity - the number of IDs, positive
+ */
+IDAllocator::IDAllocator(int capacity) : _capacity(capacity), _freeCount(capacity),
+                                         _levelsCount(0)
+{
+    // the bits of every level past the last ID or word below stay cleared
+    int bits = capacity;
+    do
+    {
+        int words = (bits + ID_WORD_BITS - 1) / ID_WORD_BITS;
+        uint64_t *level = new uint64_t[words];
+        for (int i = 0; i < words; ++i)
+        {
+            int left = bits - i * ID_WORD_BITS;
+            level[i] = left >= ID_WORD_BITS ? ~(uint64_t) 0 : ((uint64_t) 1 << left) - 1;
+        }
+        _levels[_levelsCount++] = level;
+        bits = words;
+    } while (bits > 1);
+}
+
+/**
+ * IDAllocator destructor
+ */
+IDAllocator::~IDAllocator()
+{
+    for (int i = 0; i < _levelsCount; ++i)
+    {
+        delete[] _levels[i];
+    }
+}
+
+/**
+ * @return the number of IDs
+ */
+int IDAllocator::getCapacity() const
+{
+    return _capacity;
+}
+
+/**
+ * @return the smallest free ID, -1 if all the IDs are taken
+ */
+int IDAllocator::first() const
+{
+    if (_levels[_levelsCount - 1][0] == 0)
+    {
+        return -1;
+    }
+    int index = 0;
+    for (int level = _levelsCount - 1; level >= 0; --level)
+    {
+        index = index * ID_WORD_BITS + __builtin_ctzll(_levels[level][index]);
+    }
+    return index;
+}
+
+/**
+ * @return the number of free IDs
+ */
+int IDAllocator::freeCount() const
+{
+    return _freeCount;
+}
+
+/**
+ * mark an ID as taken
+ * @param id - the ID, which must be free
+ */
+void IDAllocator::take(int id)
+{
+    _freeCount--;
+    int index = id;
+    for (int level = 0; level < _levelsCount; ++level)
+    {
+        uint64_t *word = &_levels[level][index / ID_WORD_BITS];
+        *word &= ~WORD_BIT(index);
+        if (*word != 0)
+        {
+            return;
+        }
+        index /= ID_WORD_BITS;
+    }
+}
+
+/**
+ * mark an ID as free
+ * @param id - the ID, which must be taken
+ */
+void IDAllocator::release(int id)
+{
+    _freeCount++;
+    int index = id;
+    for (int level = 0; level < _levelsCount; ++level)
+    {
+        uint64_t *word = &_levels[level][index / ID_WORD_BITS];
+        bool wasEmpty = *word == 0;
+        *word |= WORD_BIT(index);
+        if (!wasEmpty)
+        {
+            return;
+        }
+        index /= ID_WORD_BITS;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef ID_ALLOCATOR_H
+#define ID_ALLOCATOR_H
+
+#include <stdint.h>
+
+#define ID_WORD_BITS 64
+#define ID_MAX_LEVELS 6 /* enough for any int capacity */
+
+/**
+ * the set of free IDs between 0 and a capacity chosen at construction, which hands out the
+ * smallest free ID.
+ * level 0 is a bitmap of the free IDs, and every level above it has a bit for each word of the
+ * level below that has any bit set, up to a level of a single word. finding the smallest free ID
+ * goes down one word per level, and taking or releasing an ID goes up only while a word becomes
+ * empty or stops being empty, so all the operations cost O(log64(capacity)) - at most 4 words for
+ * 16M IDs - and never allocate memory.
+ */
+class IDAllocator
+{
+public:
+
+/**
+ * IDAllocator constructor - creates a set in which all the IDs are free
+ * @param capacity - the number of IDs, positive
+ */
+    explicit IDAllocator(int capacity);
+
+/**
+ * IDAllocator destructor
+ */
+    ~IDAllocator();
+
+/**
+ * @return the number of IDs
+ */
+    int getCapacity() const;
+
+/**
+ * @return the smallest free ID, -1 if all the IDs are taken
+ */
+    int first() const;
+
+/**
+ * @return the number of free IDs
+ */
+    int freeCount() const;
+
+/**
+ * mark an ID as taken
+ * @param id - the ID, which must be free
+ */
+    void take(int id);
+
+/**
+ * mark an ID as free
+ * @param id - the ID, which must be taken
+ */
+    void release(int id);
+
+private:
+    int _capacity;
+    int _freeCount;
+    int _levelsCount;
+    uint64_t *_levels[ID_MAX_LEVELS];
+};
+
+#endif
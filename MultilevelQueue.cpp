@@ -0,0 +1,72 @@
+#include "MultilevelQueue.h"
+
+/**
+ * MultilevelQueue constructor - creates an empty queue
+ */
+MultilevelQueue::MultilevelQueue() : _nonEmptyLevels(0)
+{}
+
+/**
+ * @return true if there are no threads in any level, false otherwise
+ */
+bool MultilevelQueue::empty() const
+{
+    return _nonEmptyLevels == 0;
+}
+
+/**
+ * add a thread to the end of the level of its priority
+ * @param thread - the thread to add
+ */
+void MultilevelQueue::pushBack(Thread *thread)
+{
+    int level = thread->getPriority();
+    _levels[level].pushBack(thread);
+    _nonEmptyLevels |= (uint64_t) 1 << level;
+}
+
+/**
+ * remove the first thread of the most urgent non-empty level
+ * @return the removed thread, nullptr if the queue is empty
+ */
+Thread *MultilevelQueue::popFront()
+{
+    if (_nonEmptyLevels == 0)
+    {
+        return nullptr;
+    }
+    int level = MAX_PRIORITY_LEVELS - 1 - __builtin_clzll(_nonEmptyLevels);
+    Thread *first = _levels[level].popFront();
+    if (_levels[level].empty())
+    {
+        _nonEmptyLevels &= ~((uint64_t) 1 << level);
+    }
+    return first;
+}
+
+/**
+ * remove a thread from the queue. the priority of the thread must not have changed since it was
+ * added
+ * @param thread - the thread to remove, must be in this queue
+ */
+void MultilevelQueue::remove(Thread *thread)
+{
+    int level = thread->getPriority();
+    _levels[level].remove(thread);
+    if (_levels[level].empty())
+    {
+        _nonEmptyLevels &= ~((uint64_t) 1 << level);
+    }
+}
+
+/**
+ * unlink all the threads in the queue
+ */
+void MultilevelQueue::clear()
+{
+    for (int level = 0; level < MAX_PRIORITY_LEVELS; ++level)
+    {
+        _levels[level].clear();
+    }
+    _nonEmptyLevels = 0;
+}
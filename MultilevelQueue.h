@@ -0,0 +1,59 @@
+#ifndef MULTILEVEL_QUEUE_H
+#define MULTILEVEL_QUEUE_H
+
+#include <stdint.h>
+#include "ThreadQueue.h"
+#include "ReadyQueue.h"
+
+#define MAX_PRIORITY_LEVELS 64
+
+/**
+ * ready structure with one FIFO ThreadQueue per priority level and a bitmap of the non-empty
+ * levels. a higher priority is more urgent (like pthread sched_priority), so the next thread to
+ * run is the first thread of the highest non-empty level, and the main thread (priority 0) never
+ * delays threads of a higher priority. All the operations are O(1) and never allocate memory.
+ */
+class MultilevelQueue : public ReadyQueue
+{
+public:
+
+/**
+ * MultilevelQueue constructor - creates an empty queue
+ */
+    MultilevelQueue();
+
+/**
+ * @return true if there are no threads in any level, false otherwise
+ */
+    bool empty() const override;
+
+/**
+ * add a thread to the end of the level of its priority
+ * @param thread - the thread to add
+ */
+    void pushBack(Thread *thread) override;
+
+/**
+ * remove the first thread of the most urgent non-empty level
+ * @return the removed thread, nullptr if the queue is empty
+ */
+    Thread *popFront() override;
+
+/**
+ * remove a thread from the queue. the priority of the thread must not have changed since it was
+ * added
+ * @param thread - the thread to remove, must be in this queue
+ */
+    void remove(Thread *thread) override;
+
+/**
+ * unlink all the threads in the queue
+ */
+    void clear() override;
+
+private:
+    ThreadQueue _levels[MAX_PRIORITY_LEVELS];
+    uint64_t _nonEmptyLevels;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#include "Reactor.h"
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#define NO_FD -1
+#define READ_EVENTS (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)
+#define WRITE_EVENTS (EPOLLOUT | EPOLLHUP | EPOLLERR)
+
+/**
+ * Reactor constructor - the reactor can not be used until create() is called
+ */
+Reactor::Reactor() : _epollFD(NO_FD), _wakeupFD(NO_FD), _waitersCount(0)
+{}
+
+/**
+ * Reactor destructor - closes the epoll instance
+ */
+Reactor::~Reactor()
+{
+    clear();
+    if (_wakeupFD != NO_FD)
+    {
+        close(_wakeupFD);
+    }
+    if (_epollFD != NO_FD)
+    {
+        close(_epollFD);
+    }
+}
+
+/**
+ * create the epoll instance and the event file that interrupts wait()
+ * @return true on success, false otherwise
+ */
+bool Reactor::create()
+{
+    _epollFD = epoll_create1(EPOLL_CLOEXEC);
+    _wakeupFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_epollFD == NO_FD || _wakeupFD == NO_FD)
+    {
+        return false;
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = _wakeupFD;
+    return epoll_ctl(_epollFD, EPOLL_CTL_ADD, _wakeupFD, &event) == 0;
+}
+
+/**
+ * add a file descriptor to epoll if it is not there yet
+ * @param fd - the file descriptor
+ * @return true on success, false otherwise with errno set by epoll_ctl
+ */
+bool Reactor::watch(int fd)
+{
+    // epoll drops a file descriptor when it is closed, so whether it is still there is left to
+    // epoll_ctl rather than remembered. adding it reports the events it is already ready for
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = fd;
+    return epoll_ctl(_epollFD, EPOLL_CTL_ADD, fd, &event) == 0 || errno == EEXIST;
+}
+
+/**
+ * add a thread that waits for a watched file descriptor
+ * @param thread - the thread
+ * @param fd - the file descriptor
+ * @param reason - WAIT_IO_READ or WAIT_IO_WRITE
+ */
+void Reactor::addWaiter(Thread *thread, int fd, int reason)
+{
+    if ((size_t) fd >= _fds.size())
+    {
+        _fds.resize(fd + 1);
+    }
+    thread->setIOFD(fd);
+    if (reason == WAIT_IO_READ)
+    {
+        _fds[fd].readers.pushBack(thread);
+    }
+    else
+    {
+        _fds[fd].writers.pushBack(thread);
+    }
+    _waitersCount++;
+}
+
+/**
+ * remove a thread before its file descriptor is ready
+ * @param thread - the thread, which waits for WAIT_IO_READ or WAIT_IO_WRITE
+ */
+void Reactor::removeWaiter(Thread *thread)
+{
+    FDWaiters *waiters = &_fds[thread->getIOFD()];
+    if (thread->getWaitReasons() & WAIT_IO_READ)
+    {
+        waiters->readers.remove(thread);
+    }
+    else
+    {
+        waiters->writers.remove(thread);
+    }
+    _waitersCount--;
+}
+
+/**
+ * @return true if any thread waits for a file descriptor, false otherwise
+ */
+bool Reactor::hasWaiters() const
+{
+    return _waitersCount > 0;
+}
+
+/**
+ * take the threads whose file descriptors are ready, without waiting
+ * @param ready - the queue to add the threads to
+ */
+void Reactor::poll(ThreadQueue *ready)
+{
+    int count = wait(_events, REACTOR_EVENTS, 0);
+    dispatch(_events, count, ready);
+}
+
+/**
+ * wait for events of the watched file descriptors. it may be called without any lock, while
+ * other workers use the reactor
+ * @param events - the buffer of the events
+ * @param maxEvents - the size of the buffer
+ * @param timeoutMsecs - the longest time to wait in milliseconds, -1 to wait until an event
+ * @return the number of events
+ */
+int Reactor::wait(struct epoll_event *events, int maxEvents, int timeoutMsecs)
+{
+    int count = epoll_wait(_epollFD, events, maxEvents, timeoutMsecs);
+    return count < 0 ? 0 : count;   // EINTR, the caller polls again anyway
+}
+
+/**
+ * take the threads that wait for the given events
+ * @param events - events returned by wait()
+ * @param count - the number of events
+ * @param ready - the queue to add the threads to
+ */
+void Reactor::dispatch(const struct epoll_event *events, int count, ThreadQueue *ready)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        int fd = events[i].data.fd;
+        if (fd == _wakeupFD)
+        {
+            uint64_t value;
+            ssize_t ret = read(_wakeupFD, &value, sizeof(value));
+            (void) ret;
+            continue;
+        }
+        if ((size_t) fd >= _fds.size())
+        {
+            continue;
+        }
+        if (events[i].events & READ_EVENTS)
+        {
+            takeAll(&_fds[fd].readers, ready);
+        }
+        if (events[i].events & WRITE_EVENTS)
+        {
+            takeAll(&_fds[fd].writers, ready);
+        }
+    }
+}
+
+/**
+ * make a wait() that is in progress return right away
+ */
+void Reactor::interrupt()
+{
+    uint64_t one = 1;
+    ssize_t ret = write(_wakeupFD, &one, sizeof(one));
+    (void) ret;
+}
+
+/**
+ * unlink all the waiting threads
+ */
+void Reactor::clear()
+{
+    for (size_t fd = 0; fd < _fds.size(); ++fd)
+    {
+        _fds[fd].readers.clear();
+        _fds[fd].writers.clear();
+    }
+    _waitersCount = 0;
+}
+
+/**
+ * move all the threads of a queue to another queue
+ * @param waiters - the queue to empty
+ * @param ready - the queue to add the threads to
+ */
+void Reactor::takeAll(ThreadQueue *waiters, ThreadQueue *ready)
+{
+    Thread *thread = waiters->popFront();
+    while (thread != nullptr)
+    {
+        _waitersCount--;
+        ready->pushBack(thread);
+        thread = waiters->popFront();
+    }
+}
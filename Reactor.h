@@ -0,0 +1,126 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <vector>
+#include <sys/epoll.h>
+#include "Thread.h"
+#include "ThreadQueue.h"
+
+#define REACTOR_EVENTS 64 /* events taken from epoll in one call */
+
+/**
+ * the threads that wait for one file descriptor
+ */
+struct FDWaiters
+{
+    ThreadQueue readers;
+    ThreadQueue writers;
+};
+
+/**
+ * epoll reactor of the threads that wait for file descriptors.
+ * a file descriptor is added to epoll edge-triggered the first time a thread waits for it, and
+ * stays there until it is closed, so waiting costs no epoll_ctl call after the first. an event
+ * wakes all the threads that wait for it, which retry their system call and wait again if it
+ * would still block. an event that arrives while no thread waits is dropped, so a thread must
+ * retry its system call after watch() and before it waits.
+ * the waiting threads are linked like in a ThreadQueue, so they must not be in any other
+ * ThreadQueue. only addWaiter() allocates memory, the other operations may run inside the
+ * signal handler.
+ */
+class Reactor
+{
+public:
+
+/**
+ * Reactor constructor - the reactor can not be used until create() is called
+ */
+    Reactor();
+
+/**
+ * Reactor destructor - closes the epoll instance
+ */
+    ~Reactor();
+
+/**
+ * create the epoll instance and the event file that interrupts wait()
+ * @return true on success, false otherwise
+ */
+    bool create();
+
+/**
+ * add a file descriptor to epoll if it is not there yet
+ * @param fd - the file descriptor
+ * @return true on success, false otherwise with errno set by epoll_ctl
+ */
+    bool watch(int fd);
+
+/**
+ * add a thread that waits for a watched file descriptor
+ * @param thread - the thread
+ * @param fd - the file descriptor
+ * @param reason - WAIT_IO_READ or WAIT_IO_WRITE
+ */
+    void addWaiter(Thread *thread, int fd, int reason);
+
+/**
+ * remove a thread before its file descriptor is ready
+ * @param thread - the thread, which waits for WAIT_IO_READ or WAIT_IO_WRITE
+ */
+    void removeWaiter(Thread *thread);
+
+/**
+ * @return true if any thread waits for a file descriptor, false otherwise
+ */
+    bool hasWaiters() const;
+
+/**
+ * take the threads whose file descriptors are ready, without waiting
+ * @param ready - the queue to add the threads to
+ */
+    void poll(ThreadQueue *ready);
+
+/**
+ * wait for events of the watched file descriptors. it may be called without any lock, while
+ * other workers use the reactor
+ * @param events - the buffer of the events
+ * @param maxEvents - the size of the buffer
+ * @param timeoutMsecs - the longest time to wait in milliseconds, -1 to wait until an event
+ * @return the number of events
+ */
+    int wait(struct epoll_event *events, int maxEvents, int timeoutMsecs);
+
+/**
+ * take the threads that wait for the given events
+ * @param events - events returned by wait()
+ * @param count - the number of events
+ * @param ready - the queue to add the threads to
+ */
+    void dispatch(const struct epoll_event *events, int count, ThreadQueue *ready);
+
+/**
+ * make a wait() that is in progress return right away
+ */
+    void interrupt();
+
+/**
+ * unlink all the waiting threads
+ */
+    void clear();
+
+private:
+    int _epollFD;
+    int _wakeupFD;
+    int _waitersCount;
+    std::vector<FDWaiters> _fds;
+    struct epoll_event _events[REACTOR_EVENTS];
+
+/**
+ * move all the threads of a queue to another queue
+ * @param waiters - the queue to empty
+ * @param ready - the queue to add the threads to
+ */
+    void takeAll(ThreadQueue *waiters, ThreadQueue *ready);
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef READY_QUEUE_H
+#define READY_QUEUE_H
+
+#include "Thread.h"
+
+/* the structures a worker can keep its READY threads in, chosen at uthread_init */
+typedef enum ReadyPolicies
+{
+    PRIORITY_POLICY, CFS_POLICY
+} ReadyPolicies;
+
+/**
+ * the ready queue of a worker. the next thread to run on the worker is taken from the front, and
+ * other workers take threads from the front as well when they have none.
+ */
+class ReadyQueue
+{
+public:
+
+/**
+ * ReadyQueue destructor
+ */
+    virtual ~ReadyQueue()
+    {}
+
+/**
+ * @return true if the queue has no threads, false otherwise
+ */
+    virtual bool empty() const = 0;
+
+/**
+ * add a thread to the queue
+ * @param thread - the thread to add
+ */
+    virtual void pushBack(Thread *thread) = 0;
+
+/**
+ * remove the thread that should run next
+ * @return the removed thread, nullptr if the queue is empty
+ */
+    virtual Thread *popFront() = 0;
+
+/**
+ * remove a thread from the queue
+ * @param thread - the thread to remove, must be in this queue
+ */
+    virtual void remove(Thread *thread) = 0;
+
+/**
+ * remove all the threads in the queue
+ */
+    virtual void clear() = 0;
+};
+
+#endif
@@ -1,136 +1,403 @@
 #include "Scheduler.h"
 
+#define ID_WORDS(capacity) (((capacity) + ID_WORD_BITS - 1) / ID_WORD_BITS)
+#define ID_WORD(tid) ((tid) / ID_WORD_BITS)
+#define ID_BIT(tid) ((uint64_t) 1 << ((tid) % ID_WORD_BITS))
 
 /**
  * Scheduler constructor
- * @param quantum_usecs - quantums list
- * @param size - the size of the given list
+ * @param quantumNsecs - quantums list in nanoseconds, one quantum per priority level
+ * @param size - the size of the given list, at most MAX_PRIORITY_LEVELS
+ * @param workers - the number of workers, between 1 and MAX_WORKERS
+ * @param policy - the kind of ready queue every worker has
+ * @param capacity - the maximal number of threads, including the main thread
  */
-Scheduler::Scheduler(int *quantum_usecs, int size) : _quantum_usecs_size(size),
-                                                     _quantum_usecs(quantum_usecs),
-                                                     _totalQuantums(INIT_TOTAL_QUANTUMS),
-                                                     _runningThread(nullptr)
-{}
+Scheduler::Scheduler(const int64_t *quantumNsecs, int size, int workers, ReadyPolicies policy,
+                     int capacity) :
+        _priorityLevels(size), _totalQuantums(INIT_TOTAL_QUANTUMS), _workersCount(workers),
+        _readyCount(0), _capacity(capacity), _freeIDs(capacity), _addedCount(0),
+        _stackPoolsCount(StackPool::roundToPages(STACK_SIZE) / StackPool::roundToPages(1)),
+        _guardedStacks(true)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        _quantumNsecs[i] = quantumNsecs[i];
+    }
+    for (int i = 0; i < workers; ++i)
+    {
+        ReadyQueue *readyQueue;
+        if (policy == CFS_POLICY)
+        {
+            readyQueue = new CFSQueue(capacity);
+        }
+        else
+        {
+            readyQueue = new MultilevelQueue();
+        }
+        _workers[i] = new Worker(i, readyQueue);
+    }
+    // the exit values and joiners are kept by ID, since a thread that exited unjoined is deleted
+    _threadsTable = new Thread *[capacity];
+    _exitValues = new void *[capacity];
+    _joiners = new ThreadQueue[capacity];
+    _zombieIDs = new uint64_t[ID_WORDS(capacity)];
+    _stackPools = new StackPool *[_stackPoolsCount];
+    for (size_t i = 0; i < _stackPoolsCount; ++i)
+    {
+        _stackPools[i] = nullptr;
+    }
+    for (int i = 0; i < capacity; ++i)
+    {
+        _threadsTable[i] = nullptr;
+        _exitValues[i] = nullptr;
+    }
+    for (int i = 0; i < ID_WORDS(capacity); ++i)
+    {
+        _zombieIDs[i] = 0;
+    }
+}
 
 /**
- * check if _threadsMap contains a given key
- * @param key the key to check
- * @return true if the key is in the map, false otherwise
+ * check if _threadsTable contains a thread with the given ID
+ * @param tid the ID to check
+ * @return true if there is such a thread, false otherwise
  */
-bool Scheduler::containsKeyThreadsMap(int key) const
+bool Scheduler::containsKeyThreadsTable(int tid) const
 {
-    return _threadsMap.find(key) != _threadsMap.end();
+    return tid >= 0 && tid < _capacity && _threadsTable[tid] != nullptr;
 }
 
 /**
- * check if there is a number between 0 to 99 that is not using as thread ID
+ * find the smallest number between 0 to the capacity - 1 that is not used as a thread ID
  * @return the available number is there is one, -1 otherwise
  */
 int Scheduler::getAvailableID() const
 {
-    for (int i = 0; i < MAX_THREAD_NUM; ++i)
+    return _freeIDs.first();
+}
+
+/**
+ * @return the number of numbers between 0 to the capacity - 1 that are not used as thread IDs
+ */
+int Scheduler::getAvailableCount() const
+{
+    return _freeIDs.freeCount();
+}
+
+/**
+ * @return the maximal number of threads, including the main thread
+ */
+int Scheduler::getCapacity() const
+{
+    return _capacity;
+}
+
+/**
+ * @param priority - a priority level
+ * @return the quantum of the priority level in nanoseconds
+ */
+int64_t Scheduler::getQuantum(int priority) const
+{
+    return this->_quantumNsecs[priority];
+}
+
+/**
+ * @return the size of the quantum list, which is the number of priority levels
+ */
+int Scheduler::getPriorityLevels() const
+{
+    return this->_priorityLevels;
+}
+
+/**
+ * add new thread to _threadsTable, mark its ID as used and give it the next serial
+ * @param newThread - the tread to add
+ */
+void Scheduler::addThreadsTable(Thread *newThread)
+{
+    int tid = newThread->getID();
+    newThread->setSerial(_addedCount++);
+    _threadsTable[tid] = newThread;
+    _freeIDs.take(tid);
+}
+
+/**
+ * @return the number of workers
+ */
+int Scheduler::getWorkersCount() const
+{
+    return _workersCount;
+}
+
+/**
+ * @param index - the index of a worker
+ * @return the worker with the given index
+ */
+Worker *Scheduler::getWorker(int index)
+{
+    return _workers[index];
+}
+
+/**
+ * take the lock that guards the scheduler when there is more than one worker. it is held across
+ * context switches and released by the thread that is switched to.
+ */
+void Scheduler::lock()
+{
+    if (_workersCount > 1)
     {
-        if (!containsKeyThreadsMap(i))
-        {
-            return i;
-        }
+        _lock.lock();
     }
-    return FAIL;
 }
 
 /**
- * @return the quantum list
+ * release the lock that guards the scheduler
  */
-int *Scheduler::getQuantum_usecs() const
+void Scheduler::unlock()
 {
-    return this->_quantum_usecs;
+    if (_workersCount > 1)
+    {
+        _lock.unlock();
+    }
 }
 
 /**
- * add new thread to _threadsMap
+ * add new thread to the end of the level of its priority in the ready queue of a worker
  * @param newThread - the tread to add
+ * @param worker - the index of the worker
  */
-void Scheduler::addThreadsMap(Thread *newThread)
+void Scheduler::addReadyThreadsQueue(Thread *newThread, int worker)
 {
-    this->_threadsMap[newThread->getID()] = newThread;
+    newThread->setWorker(worker);
+    _workers[worker]->getReadyQueue()->pushBack(newThread);
+    _readyCount++;
 }
 
 /**
- * add new thread to _readyThreadsQueue
- * @param newThread - the tread to add
+ * remove the next thread to run on a worker - the first thread of the highest priority level in
+ * its own ready queue, or if that is empty, in the ready queue of another worker
+ * @param worker - the index of the worker
+ * @return the removed thread, nullptr if there are no READY threads
  */
-void Scheduler::addReadyThreadsQueue(Thread **newThread)
+Thread *Scheduler::popReadyThread(int worker)
 {
-    this->_readyThreadsQueue.push_back((*newThread));
+    if (_readyCount == 0)
+    {
+        return nullptr;
+    }
+    Thread *thread = _workers[worker]->getReadyQueue()->popFront();
+    // steal from the next workers in a round, so idle workers spread over the busy ones
+    for (int i = 1; thread == nullptr && i < _workersCount; ++i)
+    {
+        thread = _workers[(worker + i) % _workersCount]->getReadyQueue()->popFront();
+    }
+    thread->setWorker(worker);
+    _readyCount--;
+    return thread;
 }
 
 /**
- * add new thread to _blockedThreadsMap
- * @param newThread - the tread to add
+ * @return true if any worker has a READY thread, false otherwise
  */
-void Scheduler::addBlockedThreadsMap(Thread *newThread)
+bool Scheduler::hasReadyThreads() const
 {
-    this->_blockedThreadsMap[newThread->getID()] = newThread;
+    return _readyCount > 0;
 }
 
 /**
- * @return a pointer to _threadsMap
+ * unlink the threads in all the ready queues
  */
-std::map<int, Thread *> *Scheduler::getThreadsMap()
+void Scheduler::clearReadyThreads()
 {
-    return &_threadsMap;
+    for (int i = 0; i < _workersCount; ++i)
+    {
+        _workers[i]->getReadyQueue()->clear();
+    }
+    _readyCount = 0;
 }
 
 /**
- * remove a thread from _readyThreadsQueue
- * @param tid - the ID of the thread that need to be removed
+ * @param thread - a thread
+ * @return true if the thread is the running thread of its worker, false otherwise
  */
-void Scheduler::removeFromReadyThreadsQueue(int tid)
+bool Scheduler::isOnCPU(Thread *thread)
 {
-    auto iter = _readyThreadsQueue.begin();
-    while (iter != _readyThreadsQueue.end())
+    return _workers[thread->getWorker()]->getRunningThread() == thread;
+}
+
+/**
+ * @param tid - the ID of the thread
+ * @return the thread with the given ID, nullptr if there is no such thread
+ */
+Thread *Scheduler::getThread(int tid) const
+{
+    return containsKeyThreadsTable(tid) ? _threadsTable[tid] : nullptr;
+}
+
+/**
+ * remove a thread from the ready queue it is in
+ * @param thread - the thread that need to be removed, must be in state READY
+ */
+void Scheduler::removeFromReadyThreadsQueue(Thread *thread)
+{
+    _workers[thread->getWorker()]->getReadyQueue()->remove(thread);
+    _readyCount--;
+}
+
+/**
+ * @return the wheel of the threads that sleep in uthread_sleep, in ticks of total quantums
+ */
+TimerWheel *Scheduler::getQuantumsWheel()
+{
+    return &_quantumsWheel;
+}
+
+/**
+ * @return the wheel of the threads that sleep in uthread_sleep_usecs, in ticks of microseconds
+ * of CLOCK_MONOTONIC
+ */
+TimerWheel *Scheduler::getUsecsWheel()
+{
+    return &_usecsWheel;
+}
+
+/**
+ * remove a sleeping thread from the wheel it sleeps in
+ * @param thread - the thread, which waits for WAIT_SLEEP_QUANTUMS or WAIT_SLEEP_USECS
+ */
+void Scheduler::removeFromSleeping(Thread *thread)
+{
+    if (thread->getWaitReasons() & WAIT_SLEEP_QUANTUMS)
     {
-        if ((*iter)->getID() == tid)
-        {
-            _readyThreadsQueue.erase(iter);
-            return;
-        }
-        ++iter;
+        _quantumsWheel.remove(thread);
+    }
+    else
+    {
+        _usecsWheel.remove(thread);
     }
 }
 
 /**
- * remove a thread from _blockedThreadsMap
- * @param tid - the ID of the thread that need to be removed
+ * unlink the threads in all the wheels
+ */
+void Scheduler::clearSleepingThreads()
+{
+    _quantumsWheel.clear();
+    _usecsWheel.clear();
+}
+
+/**
+ * @return the reactor of the threads that wait for file descriptors
+ */
+Reactor *Scheduler::getReactor()
+{
+    return &_reactor;
+}
+
+/**
+ * @param tid - the ID of a thread
+ * @return the threads that wait in uthread_join for the thread with the given ID to terminate
+ */
+ThreadQueue *Scheduler::getJoiners(int tid)
+{
+    return &_joiners[tid];
+}
+
+/**
+ * keep the exit value of a thread that terminated with no thread joining it, and keep its ID used
+ * until it is joined
+ * @param tid - the ID of the thread, which was removed from _threadsTable
+ * @param exitValue - the value it exited with
  */
-void Scheduler::removeFromBlockedThreadsMap(int tid)
+void Scheduler::addZombie(int tid, void *exitValue)
 {
-    _blockedThreadsMap.erase(tid);
+    _exitValues[tid] = exitValue;
+    _zombieIDs[ID_WORD(tid)] |= ID_BIT(tid);
+    _freeIDs.take(tid);
 }
 
 /**
- * remove a thread from _threadsMap
+ * @param tid - an ID
+ * @return true if a thread with the given ID terminated and waits to be joined, false otherwise
+ */
+bool Scheduler::isZombie(int tid) const
+{
+    return tid >= 0 && tid < _capacity && (_zombieIDs[ID_WORD(tid)] & ID_BIT(tid)) != 0;
+}
+
+/**
+ * forget a thread that waits to be joined and mark its ID as available
+ * @param tid - the ID of the thread, isZombie(tid) must be true
+ * @return the value the thread exited with
+ */
+void *Scheduler::removeZombie(int tid)
+{
+    void *exitValue = _exitValues[tid];
+    _exitValues[tid] = nullptr;
+    _zombieIDs[ID_WORD(tid)] &= ~ID_BIT(tid);
+    _freeIDs.release(tid);
+    return exitValue;
+}
+
+/**
+ * remove a thread from _threadsTable and mark its ID as available
  * @param tid - the ID of the thread that need to be removed
  */
-void Scheduler::removeFromThreadsMap(int tid)
+void Scheduler::removeFromThreadsTable(int tid)
 {
-    _threadsMap.erase(tid);
+    _threadsTable[tid] = nullptr;
+    _freeIDs.release(tid);
+}
+
+/**
+ * @param stackSize - the size of a stack in bytes
+ * @return the pool of the stacks of that size rounded up to whole pages, made on first use, or
+ * nullptr if the size is larger than STACK_SIZE, since larger stacks are not pooled
+ */
+StackPool *Scheduler::getStackPool(size_t stackSize)
+{
+    size_t pages = StackPool::roundToPages(stackSize) / StackPool::roundToPages(1);
+    if (pages == 0 || pages > _stackPoolsCount)
+    {
+        return nullptr;
+    }
+    if (_stackPools[pages - 1] == nullptr)
+    {
+        _stackPools[pages - 1] = new StackPool(stackSize, _capacity, _guardedStacks);
+    }
+    return _stackPools[pages - 1];
 }
 
 /**
- * @return _runningThread map
+ * choose whether the stacks of the pools get guard pages. the pools are made again, with only
+ * the stacks that are cached in them released
+ * @param guarded - true to give every stack a guard page, false to map them in slabs without one
+ * @return true on success, false if a thread has a stack from a pool
  */
-Thread *Scheduler::getRunningThread()
+bool Scheduler::setGuardedStacks(bool guarded)
 {
-    return this->_runningThread;
+    for (size_t i = 0; i < _stackPoolsCount; ++i)
+    {
+        if (_stackPools[i] != nullptr && !_stackPools[i]->isIdle())
+        {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < _stackPoolsCount; ++i)
+    {
+        delete _stackPools[i];
+        _stackPools[i] = nullptr;
+    }
+    _guardedStacks = guarded;
+    return true;
 }
 
 /**
- * @return _readyThreadsQueue queue - the queue contains all threads with state READY
+ * @return the profiler of the high-water marks of the stacks
  */
-std::deque<Thread *> *Scheduler::getReadyThreadsQueue()
+StackProfiler *Scheduler::getStackProfiler()
 {
-    return &(this->_readyThreadsQueue);
+    return &_stackProfiler;
 }
 
 /**
@@ -150,12 +417,12 @@ void Scheduler::setTotalQuantums()
 }
 
 /**
- * chane the thread that is currently running
- * @param newThread - new running thread
+ * increase the amount of the total quantums by the quantums that passed while no thread ran
+ * @param count - the number of quantums
  */
-void Scheduler::setRunningThread(Thread *newThread)
+void Scheduler::addTotalQuantums(int count)
 {
-    this->_runningThread = newThread;
+    this->_totalQuantums += count;
 }
 
 /**
@@ -163,34 +430,46 @@ void Scheduler::setRunningThread(Thread *newThread)
  */
 Scheduler::~Scheduler()
 {
-    auto iter = getThreadsMap()->begin();
-    while (iter != getThreadsMap()->end())
+    clearReadyThreads();
+    clearSleepingThreads();
+    _reactor.clear();
+    for (int i = 0; i < _capacity; ++i)
     {
-        delete (*iter).second;
-        (*iter).second = nullptr;
-        ++iter;
+        _joiners[i].clear();
+        if (_threadsTable[i] != nullptr)
+        {
+            delete _threadsTable[i];
+            removeFromThreadsTable(i);
+        }
     }
-    _readyThreadsQueue.clear();
-    _blockedThreadsMap.clear();
-    _recentlyDeleted.clear();
-    _threadsMap.clear();
-}
-
-/**
- * @return _blockedThreadsMap map - the map contains all threads with state BLOCKED
- */
-std::map<int, Thread *> *Scheduler::getBlockedMap()
-{
-    return &_blockedThreadsMap;
+    Thread *toDelete = _recentlyDeleted.popFront();
+    while (toDelete != nullptr)
+    {
+        delete toDelete;
+        toDelete = _recentlyDeleted.popFront();
+    }
+    for (int i = 0; i < _workersCount; ++i)
+    {
+        delete _workers[i];
+    }
+    delete[] _threadsTable;
+    delete[] _exitValues;
+    delete[] _joiners;
+    delete[] _zombieIDs;
+    for (size_t i = 0; i < _stackPoolsCount; ++i)
+    {
+        delete _stackPools[i];
+    }
+    delete[] _stackPools;
 }
 
 /**
-* @return _recentlyDeleted vector - the vector contains all threads that terminated themselves
+* @return _recentlyDeleted queue - the queue contains all threads that terminated themselves
  * and had'nt been deleted yet
 */
-std::vector<Thread *> Scheduler::getRecentlyDeleted()
+ThreadQueue *Scheduler::getRecentlyDeleted()
 {
-    return _recentlyDeleted;
+    return &_recentlyDeleted;
 }
 
 
@@ -198,9 +477,9 @@ std::vector<Thread *> Scheduler::getRecentlyDeleted()
  * add new thread to _recentlyDeleted
  * @param newThread - the thread to add
  */
-void Scheduler::addRecentlyDeletedVec(Thread *newThread)
+void Scheduler::addRecentlyDeleted(Thread *newThread)
 {
-    _recentlyDeleted.push_back(newThread);
+    _recentlyDeleted.pushBack(newThread);
 }
 
 
@@ -1,13 +1,21 @@
 #ifndef SCHEDULER_H
 #define SCHEDULER_H
 
-#include <map>
-#include <deque>
-#include <vector>
+#include <stdint.h>
+// before Thread.h, whose STACK_SIZE replaces the one of uthreads.h as in uthreads.cpp
+#include "uthreads_ext.h"
 #include "Thread.h"
+#include "MultilevelQueue.h"
+#include "CFSQueue.h"
+#include "StackPool.h"
+#include "SpinLock.h"
+#include "Worker.h"
+#include "TimerWheel.h"
+#include "Reactor.h"
+#include "IDAllocator.h"
+#include "StackProfiler.h"
 
 #define MAIN_THREAD 0
-#define MAX_THREAD_NUM 100
 #define FAIL -1
 #define INIT_TOTAL_QUANTUMS 1
 
@@ -17,10 +25,14 @@ public:
 
 /**
  * Scheduler constructor
- * @param quantum_usecs - quantums list
- * @param size - the size of the given list
+ * @param quantumNsecs - quantums list in nanoseconds, one quantum per priority level
+ * @param size - the size of the given list, at most MAX_PRIORITY_LEVELS
+ * @param workers - the number of workers, between 1 and MAX_WORKERS
+ * @param policy - the kind of ready queue every worker has
+ * @param capacity - the maximal number of threads, including the main thread
  */
-    explicit Scheduler(int *quantum_usecs, int size);
+    Scheduler(const int64_t *quantumNsecs, int size, int workers, ReadyPolicies policy,
+              int capacity);
 
 /**
  * Scheduler destructor
@@ -28,79 +40,189 @@ public:
     ~Scheduler();
 
 /**
- * check if _threadsMap contains a given key
- * @param key the key to check
- * @return true if the key is in the map, false otherwise
+ * check if _threadsTable contains a thread with the given ID
+ * @param tid the ID to check
+ * @return true if there is such a thread, false otherwise
  */
-    bool containsKeyThreadsMap(int key) const;
+    bool containsKeyThreadsTable(int tid) const;
 
 /**
- * check if there is a number between 0 to 99 that is not using as thread ID
+ * find the smallest number between 0 to the capacity - 1 that is not used as a thread ID
  * @return the available number is there is one, -1 otherwise
  */
     int getAvailableID() const;
 
 /**
- * @return the quantum list
+ * @return the number of numbers between 0 to the capacity - 1 that are not used as thread IDs
  */
-    int *getQuantum_usecs() const;
+    int getAvailableCount() const;
 
 /**
- * @return a pointer to _threadsMap
+ * @return the maximal number of threads, including the main thread
  */
-    std::map<int, Thread *> *getThreadsMap();
+    int getCapacity() const;
 
 /**
- * add new thread to _threadsMap
- * @param newThread - the thread to add
+ * @param priority - a priority level
+ * @return the quantum of the priority level in nanoseconds
+ */
+    int64_t getQuantum(int priority) const;
+
+/**
+ * @return the size of the quantum list, which is the number of priority levels
  */
-    void addThreadsMap(Thread *newThread);
+    int getPriorityLevels() const;
 
 /**
- * add new thread to _readyThreadsQueue
+ * @param tid - the ID of the thread
+ * @return the thread with the given ID, nullptr if there is no such thread
+ */
+    Thread *getThread(int tid) const;
+
+/**
+ * add new thread to _threadsTable, mark its ID as used and give it the next serial
  * @param newThread - the thread to add
  */
-    void addReadyThreadsQueue(Thread **newThread);
+    void addThreadsTable(Thread *newThread);
 
 /**
- * add new thread to _blockedThreadsMap
+ * @return the number of workers
+ */
+    int getWorkersCount() const;
+
+/**
+ * @param index - the index of a worker
+ * @return the worker with the given index
+ */
+    Worker *getWorker(int index);
+
+/**
+ * take the lock that guards the scheduler when there is more than one worker. it is held across
+ * context switches and released by the thread that is switched to.
+ */
+    void lock();
+
+/**
+ * release the lock that guards the scheduler
+ */
+    void unlock();
+
+/**
+ * add new thread to the end of the level of its priority in the ready queue of a worker
  * @param newThread - the thread to add
+ * @param worker - the index of the worker
  */
-    void addBlockedThreadsMap(Thread *newThread);
+    void addReadyThreadsQueue(Thread *newThread, int worker);
 
 /**
- * remove a thread from _readyThreadsQueue
- * @param tid - the ID of the thread that need to be removed
+ * remove the next thread to run on a worker - the first thread of the highest priority level in
+ * its own ready queue, or if that is empty, in the ready queue of another worker
+ * @param worker - the index of the worker
+ * @return the removed thread, nullptr if there are no READY threads
  */
-    void removeFromReadyThreadsQueue(int tid);
+    Thread *popReadyThread(int worker);
 
 /**
- * remove a thread from _blockedThreadsMap
- * @param tid - the ID of the thread that need to be removed
+ * @return true if any worker has a READY thread, false otherwise
+ */
+    bool hasReadyThreads() const;
+
+/**
+ * unlink the threads in all the ready queues
+ */
+    void clearReadyThreads();
+
+/**
+ * @param thread - a thread
+ * @return true if the thread is the running thread of its worker, false otherwise
+ */
+    bool isOnCPU(Thread *thread);
+
+/**
+ * remove a thread from the ready queue it is in
+ * @param thread - the thread that need to be removed, must be in state READY
+ */
+    void removeFromReadyThreadsQueue(Thread *thread);
+
+/**
+ * @return the wheel of the threads that sleep in uthread_sleep, in ticks of total quantums
+ */
+    TimerWheel *getQuantumsWheel();
+
+/**
+ * @return the wheel of the threads that sleep in uthread_sleep_usecs, in ticks of microseconds
+ * of CLOCK_MONOTONIC
+ */
+    TimerWheel *getUsecsWheel();
+
+/**
+ * remove a sleeping thread from the wheel it sleeps in
+ * @param thread - the thread, which waits for WAIT_SLEEP_QUANTUMS or WAIT_SLEEP_USECS
+ */
+    void removeFromSleeping(Thread *thread);
+
+/**
+ * unlink the threads in all the wheels
+ */
+    void clearSleepingThreads();
+
+/**
+ * @return the reactor of the threads that wait for file descriptors
+ */
+    Reactor *getReactor();
+
+/**
+ * @param tid - the ID of a thread
+ * @return the threads that wait in uthread_join for the thread with the given ID to terminate
+ */
+    ThreadQueue *getJoiners(int tid);
+
+/**
+ * keep the exit value of a thread that terminated with no thread joining it, and keep its ID used
+ * until it is joined
+ * @param tid - the ID of the thread, which was removed from _threadsTable
+ * @param exitValue - the value it exited with
+ */
+    void addZombie(int tid, void *exitValue);
+
+/**
+ * @param tid - an ID
+ * @return true if a thread with the given ID terminated and waits to be joined, false otherwise
+ */
+    bool isZombie(int tid) const;
+
+/**
+ * forget a thread that waits to be joined and mark its ID as available
+ * @param tid - the ID of the thread, isZombie(tid) must be true
+ * @return the value the thread exited with
  */
-    void removeFromBlockedThreadsMap(int tid);
+    void *removeZombie(int tid);
 
 /**
- * remove a thread from _threadsMap
+ * remove a thread from _threadsTable and mark its ID as available
  * @param tid - the ID of the thread that need to be removed
  */
-    void removeFromThreadsMap(int tid);
+    void removeFromThreadsTable(int tid);
 
 /**
- * @return _runningThread map
+ * @param stackSize - the size of a stack in bytes
+ * @return the pool of the stacks of that size rounded up to whole pages, made on first use, or
+ * nullptr if the size is larger than STACK_SIZE, since larger stacks are not pooled
  */
-    Thread *getRunningThread();
+    StackPool *getStackPool(size_t stackSize);
 
 /**
- * chane the thread that is currently running
- * @param newThread - new running thread
+ * choose whether the stacks of the pools get guard pages. the pools are made again, with only
+ * the stacks that are cached in them released
+ * @param guarded - true to give every stack a guard page, false to map them in slabs without one
+ * @return true on success, false if a thread has a stack from a pool
  */
-    void setRunningThread(Thread *newThread);
+    bool setGuardedStacks(bool guarded);
 
 /**
- * @return _readyThreadsQueue queue - the queue contains all threads with state READY
+ * @return the profiler of the high-water marks of the stacks
  */
-    std::deque<Thread *> *getReadyThreadsQueue();
+    StackProfiler *getStackProfiler();
 
 /**
  * @return the total amount of Quantums
@@ -113,31 +235,46 @@ public:
     void setTotalQuantums();
 
 /**
- * @return _blockedThreadsMap map - the map contains all threads with state BLOCKED
+ * increase the amount of the total quantums by the quantums that passed while no thread ran
+ * @param count - the number of quantums
  */
-    std::map<int, Thread *> *getBlockedMap();
+    void addTotalQuantums(int count);
 
 /**
-* @return _recentlyDeleted vector - the vector contains all threads that terminated themselves
+* @return _recentlyDeleted queue - the queue contains all threads that terminated themselves
 * and had'nt been deleted yet
 */
-    std::vector<Thread *> getRecentlyDeleted();
+    ThreadQueue *getRecentlyDeleted();
 
 /**
  * add new thread to _recentlyDeleted
  * @param newThread - the thread to add
  */
-    void addRecentlyDeletedVec(Thread *newThread);
+    void addRecentlyDeleted(Thread *newThread);
 
 private:
-    int _quantum_usecs_size;
-    int *_quantum_usecs;
+    int _priorityLevels;
+    int64_t _quantumNsecs[MAX_PRIORITY_LEVELS];
     int _totalQuantums;
-    Thread *_runningThread;
-    std::map<int, Thread *> _threadsMap;
-    std::deque<Thread *> _readyThreadsQueue;
-    std::map<int, Thread *> _blockedThreadsMap;
-    std::vector<Thread *> _recentlyDeleted;
+    int _workersCount;
+    Worker *_workers[MAX_WORKERS];
+    int _readyCount;
+    SpinLock _lock;
+    int _capacity;
+    Thread **_threadsTable;
+    IDAllocator _freeIDs;
+    uint64_t _addedCount;
+    uint64_t *_zombieIDs;
+    void **_exitValues;
+    ThreadQueue *_joiners;
+    TimerWheel _quantumsWheel;
+    TimerWheel _usecsWheel;
+    Reactor _reactor;
+    ThreadQueue _recentlyDeleted;
+    size_t _stackPoolsCount;
+    StackPool **_stackPools;    /* by the number of pages of the stacks */
+    bool _guardedStacks;
+    StackProfiler _stackProfiler;
 
 
 };
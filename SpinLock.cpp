@@ -0,0 +1,55 @@
+#include "SpinLock.h"
+#include <sched.h>
+
+#define SPINS_BEFORE_YIELD 128
+#define SPINS_BEFORE_STARVING (SPINS_BEFORE_YIELD + 8)
+
+/**
+ * SpinLock constructor - creates an unlocked lock
+ */
+SpinLock::SpinLock() : _locked(false), _starvingWaiters(0)
+{}
+
+/**
+ * wait until the lock is free and take it. after a while of spinning the kernel thread yields the
+ * CPU between attempts, in case the holder was descheduled
+ */
+void SpinLock::lock()
+{
+    int spins = 0;
+    bool starving = false;
+    while (true)
+    {
+        if (!_locked.load(std::memory_order_relaxed) &&
+            (starving || _starvingWaiters.load(std::memory_order_relaxed) == 0) &&
+            !_locked.exchange(true, std::memory_order_acquire))
+        {
+            break;
+        }
+        if (++spins < SPINS_BEFORE_YIELD)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+            continue;
+        }
+        sched_yield();
+        if (!starving && spins >= SPINS_BEFORE_STARVING)
+        {
+            starving = true;
+            _starvingWaiters.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (starving)
+    {
+        _starvingWaiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * release the lock
+ */
+void SpinLock::unlock()
+{
+    _locked.store(false, std::memory_order_release);
+}
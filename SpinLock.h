@@ -0,0 +1,40 @@
+#ifndef SPIN_LOCK_H
+#define SPIN_LOCK_H
+
+#include <atomic>
+
+/**
+ * a test-and-test-and-set lock that never sleeps in the kernel, so it may be taken inside a signal
+ * handler. a waiter that spun for too long becomes starving, and until the starving waiters got
+ * the lock no one else takes it, so a worker that releases and takes the lock again in a loop
+ * cannot starve the others. unlike a FIFO lock, a descheduled waiter does not hold up the rest
+ * while no one is starving. it has no owner - it may be released by a different thread of
+ * execution than the one that took it, which is how the scheduler lock is handed over a context
+ * switch.
+ */
+class SpinLock
+{
+public:
+
+/**
+ * SpinLock constructor - creates an unlocked lock
+ */
+    SpinLock();
+
+/**
+ * wait until the lock is free and take it. after a while of spinning the kernel thread yields the
+ * CPU between attempts, in case the holder was descheduled
+ */
+    void lock();
+
+/**
+ * release the lock
+ */
+    void unlock();
+
+private:
+    std::atomic<bool> _locked;
+    std::atomic<int> _starvingWaiters;
+};
+
+#endif
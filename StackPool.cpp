@@ -0,0 +1,187 @@
+#include "StackPool.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * StackPool constructor
+ * @param stackSize - the usable size of every stack in bytes, rounded up to whole pages
+ * @param maxCached - the maximal number of released stacks that are kept for reuse
+ * @param guarded - true to give every stack a guard page, false to map them in slabs without one
+ */
+StackPool::StackPool(size_t stackSize, int maxCached, bool guarded) :
+        _stackSize(roundToPages(stackSize)), _maxCached(maxCached), _cachedCount(0),
+        _acquiredCount(0), _freeList(nullptr), _guarded(guarded), _slabNext(nullptr),
+        _slabEnd(nullptr)
+{}
+
+/**
+ * StackPool destructor - unmaps all the cached stacks, or all the slabs of a pool without guard
+ * pages
+ */
+StackPool::~StackPool()
+{
+    while (_guarded && _freeList != nullptr)
+    {
+        char *stack = _freeList;
+        _freeList = *freeLink(stack);
+        unmapStack(stack, _stackSize);
+    }
+    for (size_t i = 0; i < _slabs.size(); ++i)
+    {
+        munmap(_slabs[i], _stackSize * STACKS_PER_SLAB);
+    }
+    _freeList = nullptr;
+    _cachedCount = 0;
+}
+
+/**
+ * map stacks ahead of time so the following acquire() calls do not need a system call
+ * @param count - the number of stacks to have cached
+ */
+void StackPool::prewarm(int count)
+{
+    while (_cachedCount < count && _cachedCount < _maxCached)
+    {
+        char *stack = _guarded ? mapStack(_stackSize) : carveStack();
+        if (stack == nullptr)
+        {
+            return;
+        }
+        *freeLink(stack) = _freeList;
+        _freeList = stack;
+        _cachedCount++;
+    }
+}
+
+/**
+ * @return the lowest usable address of a stack, nullptr if mapping a new stack failed
+ */
+char *StackPool::acquire()
+{
+    char *stack = _freeList;
+    if (stack == nullptr)
+    {
+        stack = _guarded ? mapStack(_stackSize) : carveStack();
+    }
+    else
+    {
+        _freeList = *freeLink(stack);
+        _cachedCount--;
+    }
+    if (stack != nullptr)
+    {
+        _acquiredCount++;
+    }
+    return stack;
+}
+
+/**
+ * return a stack to the pool
+ * @param stack - a stack returned by acquire()
+ */
+void StackPool::release(char *stack)
+{
+    _acquiredCount--;
+    if (_guarded && _cachedCount >= _maxCached)
+    {
+        unmapStack(stack, _stackSize);
+        return;
+    }
+    *freeLink(stack) = _freeList;
+    _freeList = stack;
+    _cachedCount++;
+}
+
+/**
+ * take a stack from the current slab, mapping a new slab if it is used up
+ * @return the lowest address of the stack, nullptr if mapping a new slab failed
+ */
+char *StackPool::carveStack()
+{
+    if (_slabNext == _slabEnd)
+    {
+        size_t slabSize = _stackSize * STACKS_PER_SLAB;
+        void *slab = mmap(nullptr, slabSize, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | MAP_NORESERVE, -1, 0);
+        if (slab == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        _slabs.push_back((char *) slab);
+        _slabNext = (char *) slab;
+        _slabEnd = _slabNext + slabSize;
+    }
+    char *stack = _slabNext;
+    _slabNext += _stackSize;
+    return stack;
+}
+
+/**
+ * @param stack - a cached stack
+ * @return where the link to the next cached stack is stored, at the top of the stack, which a
+ * thread that ran on it already touched, rather than at the bottom, which it usually did not
+ */
+char **StackPool::freeLink(char *stack) const
+{
+    return (char **) (stack + _stackSize) - 1;
+}
+
+/**
+ * @return the usable size of every stack in bytes
+ */
+size_t StackPool::getStackSize() const
+{
+    return _stackSize;
+}
+
+/**
+ * @return true if every stack the pool handed out was returned to it, false otherwise
+ */
+bool StackPool::isIdle() const
+{
+    return _acquiredCount == 0;
+}
+
+/**
+ * @param size - a size in bytes
+ * @return the size rounded up to whole pages
+ */
+size_t StackPool::roundToPages(size_t size)
+{
+    size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+/**
+ * map a new stack with a guard page below it, for stacks that do not come from a pool
+ * @param stackSize - the usable size of the stack, must be a multiple of the page size
+ * @return the lowest usable address of the stack, nullptr on failure
+ */
+char *StackPool::mapStack(size_t stackSize)
+{
+    size_t guardSize = (size_t) sysconf(_SC_PAGESIZE);
+    void *mapping = mmap(nullptr, guardSize + stackSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    // stacks grow down, so the guard page is the lowest page of the mapping
+    if (mprotect(mapping, guardSize, PROT_NONE) != 0)
+    {
+        munmap(mapping, guardSize + stackSize);
+        return nullptr;
+    }
+    return (char *) mapping + guardSize;
+}
+
+/**
+ * unmap a stack returned by mapStack() and its guard page
+ * @param stack - the lowest usable address of the stack
+ * @param stackSize - the usable size of the stack
+ */
+void StackPool::unmapStack(char *stack, size_t stackSize)
+{
+    size_t guardSize = (size_t) sysconf(_SC_PAGESIZE);
+    munmap(stack - guardSize, guardSize + stackSize);
+}
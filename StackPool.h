@@ -0,0 +1,109 @@
+#ifndef STACK_POOL_H
+#define STACK_POOL_H
+
+#include <stddef.h>
+#include <vector>
+
+#define STACKS_PER_SLAB 64 /* stacks mapped at once by a pool without guard pages */
+
+/**
+ * pool of thread stacks of one fixed size. every stack is mapped with mmap and has a PROT_NONE
+ * guard page below it, so a stack overflow faults immediately instead of corrupting other memory.
+ * stacks are mapped with MAP_NORESERVE, so physical pages are only committed when touched.
+ * released stacks are kept in an intrusive free list (the link is stored in the free stack
+ * itself) and handed out again, so acquiring a cached stack is a few pointer operations.
+ * a guard page costs the stack a mapping of its own, and the number of mappings of a process is
+ * limited (vm.max_map_count, 65530 by default). for more threads than that, a pool can be made
+ * without guard pages when asked to: it maps STACKS_PER_SLAB stacks at once, caches every
+ * released stack and unmaps the slabs only when it is destroyed.
+ */
+class StackPool
+{
+public:
+
+/**
+ * StackPool constructor
+ * @param stackSize - the usable size of every stack in bytes, rounded up to whole pages
+ * @param maxCached - the maximal number of released stacks that are kept for reuse
+ * @param guarded - true to give every stack a guard page, false to map them in slabs without one
+ */
+    StackPool(size_t stackSize, int maxCached, bool guarded = true);
+
+/**
+ * StackPool destructor - unmaps all the cached stacks
+ */
+    ~StackPool();
+
+/**
+ * map stacks ahead of time so the following acquire() calls do not need a system call
+ * @param count - the number of stacks to have cached
+ */
+    void prewarm(int count);
+
+/**
+ * @return the lowest usable address of a stack, nullptr if mapping a new stack failed
+ */
+    char *acquire();
+
+/**
+ * return a stack to the pool
+ * @param stack - a stack returned by acquire()
+ */
+    void release(char *stack);
+
+/**
+ * @return the usable size of every stack in bytes
+ */
+    size_t getStackSize() const;
+
+/**
+ * @return true if every stack the pool handed out was returned to it, false otherwise
+ */
+    bool isIdle() const;
+
+/**
+ * @param size - a size in bytes
+ * @return the size rounded up to whole pages
+ */
+    static size_t roundToPages(size_t size);
+
+/**
+ * map a new stack with a guard page below it, for stacks that do not come from a pool
+ * @param stackSize - the usable size of the stack, must be a multiple of the page size
+ * @return the lowest usable address of the stack, nullptr on failure
+ */
+    static char *mapStack(size_t stackSize);
+
+/**
+ * unmap a stack returned by mapStack() and its guard page
+ * @param stack - the lowest usable address of the stack
+ * @param stackSize - the usable size of the stack
+ */
+    static void unmapStack(char *stack, size_t stackSize);
+
+private:
+    size_t _stackSize;
+    int _maxCached;
+    int _cachedCount;
+    int _acquiredCount;
+    char *_freeList;
+    bool _guarded;
+    char *_slabNext;
+    char *_slabEnd;
+    std::vector<char *> _slabs;
+
+/**
+ * take a stack from the current slab, mapping a new slab if it is used up
+ * @return the lowest address of the stack, nullptr if mapping a new slab failed
+ */
+    char *carveStack();
+
+/**
+ * @param stack - a cached stack
+ * @return where the link to the next cached stack is stored, at the top of the stack, which a
+ * thread that ran on it already touched, rather than at the bottom, which it usually did not
+ */
+    char **freeLink(char *stack) const;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "StackProfiler.h"
+#include "StackPool.h"
+
+/**
+ * StackProfiler constructor - the profiler starts in STACK_OFF mode
+ */
+StackProfiler::StackProfiler() : _mode(STACK_OFF), _recordedCount(0), _recordedTotal(0),
+                                 _recordedMax(0)
+{}
+
+/**
+ * @return the mode of the profiler
+ */
+StackModes StackProfiler::getMode() const
+{
+    return _mode;
+}
+
+/**
+ * change the mode of the profiler. the threads that are already running keep being measured if
+ * they were
+ * @param mode - the new mode
+ */
+void StackProfiler::setMode(StackModes mode)
+{
+    _mode = mode;
+}
+
+/**
+ * @param stack - the lowest address of a stack
+ * @param stackSize - the size of the stack in bytes, a multiple of 8
+ */
+void StackProfiler::paint(char *stack, size_t stackSize)
+{
+    uint64_t *words = (uint64_t *) stack;
+    for (size_t i = 0; i < stackSize / sizeof(uint64_t); ++i)
+    {
+        words[i] = STACK_PAINT;
+    }
+}
+
+/**
+ * @param stack - the lowest address of a painted stack
+ * @param stackSize - the size of the stack in bytes, a multiple of 8
+ * @return the number of bytes of the stack that were used, from its top down to its deepest word
+ * that is no longer the paint
+ */
+size_t StackProfiler::measure(const char *stack, size_t stackSize)
+{
+    const uint64_t *words = (const uint64_t *) stack;
+    size_t count = stackSize / sizeof(uint64_t);
+    size_t untouched = 0;
+    while (untouched < count && words[untouched] == STACK_PAINT)
+    {
+        untouched++;
+    }
+    return (count - untouched) * sizeof(uint64_t);
+}
+
+/**
+ * add the high-water mark of a thread that terminated, and in STACK_LEARN mode raise the peak of
+ * its entry function
+ * @param func - the entry point of the thread
+ * @param usage - the bytes of its stack it used
+ */
+void StackProfiler::record(void (*func)(void), size_t usage)
+{
+    _recordedCount++;
+    _recordedTotal += usage;
+    _recordedMax = usage > _recordedMax ? usage : _recordedMax;
+    if (_mode == STACK_LEARN)
+    {
+        size_t &peak = _peaks[func];
+        peak = usage > peak ? usage : peak;
+    }
+}
+
+/**
+ * @param func - the entry point of a new thread
+ * @param stackSize - the stack size it is spawned with
+ * @return in STACK_LEARN mode, the peak of func plus STACK_LEARN_MARGIN, rounded up to whole pages,
+ * if that is smaller than stackSize, and otherwise stackSize
+ */
+size_t StackProfiler::learnedSize(void (*func)(void), size_t stackSize) const
+{
+    if (_mode != STACK_LEARN)
+    {
+        return stackSize;
+    }
+    std::unordered_map<void (*)(void), size_t>::const_iterator peak = _peaks.find(func);
+    if (peak == _peaks.end())
+    {
+        return stackSize;
+    }
+    size_t learned = StackPool::roundToPages(peak->second + STACK_LEARN_MARGIN);
+    return learned < stackSize ? learned : stackSize;
+}
+
+/**
+ * @return the number of threads whose high-water marks were recorded
+ */
+uint64_t StackProfiler::getRecordedCount() const
+{
+    return _recordedCount;
+}
+
+/**
+ * @return the sum of the recorded high-water marks in bytes
+ */
+uint64_t StackProfiler::getRecordedTotal() const
+{
+    return _recordedTotal;
+}
+
+/**
+ * @return the largest recorded high-water mark in bytes
+ */
+size_t StackProfiler::getRecordedMax() const
+{
+    return _recordedMax;
+}
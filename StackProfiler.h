@@ -0,0 +1,101 @@
+#ifndef STACK_PROFILER_H
+#define STACK_PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+
+#define STACK_PAINT 0x5354414b5354414bULL /* the word painted over a measured stack, "STAKSTAK" */
+#define STACK_LEARN_MARGIN 4096 /* added to a learned peak for a signal frame and the handler */
+
+/**
+ * what the profiler does with the stacks of the threads that are spawned
+ */
+typedef enum StackModes
+{
+    STACK_OFF, STACK_MEASURE, STACK_LEARN
+} StackModes;
+
+/**
+ * the high-water marks of the stacks of the threads. a measured stack is painted with STACK_PAINT
+ * before the thread starts, and how much of it the thread used is found by looking for the lowest
+ * word that is no longer the paint. painting commits the whole stack, so it is only done while
+ * measuring. the profiler keeps the high-water marks of the threads that terminated, and in
+ * STACK_LEARN mode also the peak of every entry function, which sizes the stacks of the threads
+ * spawned with it later.
+ */
+class StackProfiler
+{
+public:
+
+/**
+ * StackProfiler constructor - the profiler starts in STACK_OFF mode
+ */
+    StackProfiler();
+
+/**
+ * @return the mode of the profiler
+ */
+    StackModes getMode() const;
+
+/**
+ * change the mode of the profiler. the threads that are already running keep being measured if
+ * they were
+ * @param mode - the new mode
+ */
+    void setMode(StackModes mode);
+
+/**
+ * @param stack - the lowest address of a stack
+ * @param stackSize - the size of the stack in bytes, a multiple of 8
+ */
+    static void paint(char *stack, size_t stackSize);
+
+/**
+ * @param stack - the lowest address of a painted stack
+ * @param stackSize - the size of the stack in bytes, a multiple of 8
+ * @return the number of bytes of the stack that were used, from its top down to its deepest word
+ * that is no longer the paint
+ */
+    static size_t measure(const char *stack, size_t stackSize);
+
+/**
+ * add the high-water mark of a thread that terminated, and in STACK_LEARN mode raise the peak of
+ * its entry function
+ * @param func - the entry point of the thread
+ * @param usage - the bytes of its stack it used
+ */
+    void record(void (*func)(void), size_t usage);
+
+/**
+ * @param func - the entry point of a new thread
+ * @param stackSize - the stack size it is spawned with
+ * @return in STACK_LEARN mode, the peak of func plus STACK_LEARN_MARGIN, rounded up to whole pages,
+ * if that is smaller than stackSize, and otherwise stackSize
+ */
+    size_t learnedSize(void (*func)(void), size_t stackSize) const;
+
+/**
+ * @return the number of threads whose high-water marks were recorded
+ */
+    uint64_t getRecordedCount() const;
+
+/**
+ * @return the sum of the recorded high-water marks in bytes
+ */
+    uint64_t getRecordedTotal() const;
+
+/**
+ * @return the largest recorded high-water mark in bytes
+ */
+    size_t getRecordedMax() const;
+
+private:
+    StackModes _mode;
+    uint64_t _recordedCount;
+    uint64_t _recordedTotal;
+    size_t _recordedMax;
+    std::unordered_map<void (*)(void), size_t> _peaks;
+};
+
+#endif
@@ -1,78 +1,74 @@
 #include "Thread.h"
 
-/*~~~~~~~~~ translate variable's address ~~~~~~~~~*/
-#ifdef __x86_64__
-/* ~~~~~~~~ code for 64 bit Intel arch ~~~~~~~~*/
-
-typedef unsigned long address_t;
-#define JB_SP 6
-#define JB_PC 7
-
-/* A translation is required when using an address of a variable.
-   Use this as a black box in your code. */
-address_t translate_address(address_t addr)
-{
-    address_t ret;
-    asm volatile("xor    %%fs:0x30,%0\n"
-                 "rol    $0x11,%0\n"
-    : "=g" (ret)
-    : "0" (addr));
-    return ret;
-}
-
-#else
-/* ~~~~~~~~ code for 32 bit Intel arch ~~~~~~~~*/
-
-typedef unsigned int address_t;
-#define JB_SP 4
-#define JB_PC 5
-
-
 /**
- * A translation is required when using an address of a variable.
-   Use this as a black box in your code.
+ * @param priority - a priority
+ * @return the weight of the priority in the virtual runtime, VRUNTIME_BASE_WEIGHT * (5/4)^priority,
+ * so a thread runs about 1.25 times as long as a thread one level below it before it is behind
  */
-address_t translate_address(address_t addr)
+static uint64_t priorityWeight(int priority)
 {
-    address_t ret;
-    asm volatile("xor    %%gs:0x18,%0\n"
-        "rol    $0x9,%0\n"
-                 : "=g" (ret)
-                 : "0" (addr));
-    return ret;
+    uint64_t weight = VRUNTIME_BASE_WEIGHT;
+    for (int i = 0; i < priority; ++i)
+    {
+        weight += weight / 4;
+    }
+    return weight;
 }
 
-#endif
-
-
 /**
  * Thread constructor
+ * @param stackPool - the pool to take the stack of the thread from if stackSize matches its size
+ * @param stackSize - the size of the stack of the thread, 0 for a thread that runs on the stack of
+ * the process (the main thread)
+ * @param paintStack - true to paint the stack so its high-water mark can be measured
  */
-Thread::Thread(int ID, int quantum, int priority, void(*func)(void), States state, int
-countQuantums) : _ID(ID),
-                 _quantum(quantum), _priority(priority), _func(func), _state(state),
-                 _countQuantums(countQuantums)
+Thread::Thread(int ID, int64_t quantum, int priority, void(*func)(void), StackPool *stackPool,
+               size_t stackSize, bool paintStack, States state, int countQuantums) : _ID(ID),
+                 _serial(0), _quantum(quantum), _priority(priority), _func(func), _argFunc(nullptr),
+                 _arg(nullptr), _state(state),
+                 _countQuantums(countQuantums), _stack(nullptr),
+                 _stackSize(StackPool::roundToPages(stackSize)), _stackPool(stackPool),
+                 _stackPainted(false), _detached(false), _worker(0), _waitReasons(0),
+                 _wakeTick(0), _wheelSlot(0), _ioFD(-1),
+                 _waitQueue(nullptr), _messageSlot(nullptr), _stateSince(CycleClock::now()),
+                 _stats(), _weight(priorityWeight(priority)), _vruntime(0), _readyIndex(-1),
+                 _queuePrev(nullptr), _queueNext(nullptr)
 {
-    _stack = new(std::nothrow) char[STACK_SIZE];
+    if (_stackSize != 0 && _stackPool != nullptr && _stackSize == _stackPool->getStackSize())
+    {
+        _stack = _stackPool->acquire();
+    }
+    else if (_stackSize != 0)
+    {
+        _stackPool = nullptr;
+        _stack = StackPool::mapStack(_stackSize);
+    }
     if (_stack != nullptr)
     {
-        address_t sp, pc;
-        sp = (address_t) _stack + STACK_SIZE - sizeof(address_t);
-        pc = (address_t) _func;
-        sigsetjmp(env, 1);
-        (env->__jmpbuf)[JB_SP] = translate_address(sp);
-        (env->__jmpbuf)[JB_PC] = translate_address(pc);
-        sigemptyset(&env->__saved_mask);
+        // before contextInit(), which writes the first frame at the top of the stack
+        if (paintStack)
+        {
+            StackProfiler::paint(_stack, _stackSize);
+            _stackPainted = true;
+        }
+        contextInit(&ctx, _stack, _stackSize, threadStart);
     }
 }
 
 
 /**
- * Thread destructor
+ * Thread destructor - returns the stack to its pool or unmaps it
  */
 Thread::~Thread()
 {
-    delete[] _stack;
+    if (_stack != nullptr && _stackPool != nullptr)
+    {
+        _stackPool->release(_stack);
+    }
+    else if (_stack != nullptr)
+    {
+        StackPool::unmapStack(_stack, _stackSize);
+    }
     _stack = nullptr;
 }
 
@@ -85,20 +81,97 @@ int Thread::getID() const
 }
 
 /**
- * @return The quantum of the Thread
+ * @return The number of threads that were added before the Thread, which unlike its ID is never
+ * reused
+ */
+uint64_t Thread::getSerial() const
+{
+    return this->_serial;
+}
+
+/**
+ * @param serial - The number of threads that were added before the Thread
+ */
+void Thread::setSerial(uint64_t serial)
+{
+    this->_serial = serial;
+}
+
+/**
+ * @return The entry point of the Thread
+ */
+void (*Thread::getFunc() const)(void)
+{
+    return this->_func;
+}
+
+/**
+ * @return The entry point of the Thread that takes an argument, nullptr if it starts in getFunc()
  */
-int Thread::getQuantum() const
+void (*Thread::getArgFunc() const)(void *)
+{
+    return this->_argFunc;
+}
+
+/**
+ * @return The argument of getArgFunc()
+ */
+void *Thread::getArg() const
+{
+    return this->_arg;
+}
+
+/**
+ * make the Thread start in a function that takes an argument instead of in getFunc()
+ * @param argFunc - the function
+ * @param arg - its argument
+ */
+void Thread::setArgFunc(void (*argFunc)(void *), void *arg)
+{
+    this->_argFunc = argFunc;
+    this->_arg = arg;
+}
+
+/**
+ * keep a block at the top of the stack of the Thread, and start the Thread below it. must be
+ * called before the Thread first runs
+ * @param size - the size of the block in bytes
+ * @param align - the alignment of the block, a power of two
+ * @return the block
+ */
+void *Thread::reserveStackTop(size_t size, size_t align)
+{
+    uintptr_t block = ((uintptr_t) _stack + _stackSize - size) & ~((uintptr_t) align - 1);
+    contextInit(&ctx, _stack, block - (uintptr_t) _stack, threadStart);
+    return (void *) block;
+}
+
+/**
+ * @return The quantum of the Thread in nanoseconds
+ */
+int64_t Thread::getQuantum() const
 {
     return this->_quantum;
 }
 
 /**
- * change the priority of the thread
+ * @return The priority of the Thread
+ */
+int Thread::getPriority() const
+{
+    return this->_priority;
+}
+
+/**
+ * change the priority of the thread and the quantum that comes with it
  * @param newPriority - new priority
+ * @param newQuantum - the quantum of the new priority in nanoseconds
  */
-void Thread::setPriority(int newPriority)
+void Thread::setPriority(int newPriority, int64_t newQuantum)
 {
     this->_priority = newPriority;
+    this->_quantum = newQuantum;
+    this->_weight = priorityWeight(newPriority);
 }
 
 /**
@@ -110,22 +183,197 @@ States Thread::getState() const
 }
 
 /**
- * @return The stack of the Thread
+ * @return The stack of the Thread, nullptr if it runs on the stack of the process or if there was
+ * no memory for its stack
  */
 char *Thread::getStack()
 {
     return _stack;
 }
 
+/**
+ * @return The size of the stack of the Thread in bytes
+ */
+size_t Thread::getStackSize() const
+{
+    return _stackSize;
+}
+
+/**
+ * @return true if the stack of the Thread was painted when it was allocated, false otherwise
+ */
+bool Thread::isStackPainted() const
+{
+    return _stackPainted;
+}
+
+/**
+ * @return true if the ID of the Thread is released as it terminates instead of kept for a join
+ */
+bool Thread::isDetached() const
+{
+    return _detached;
+}
+
+/**
+ * release the ID of the Thread as it terminates instead of keeping it for a join
+ */
+void Thread::setDetached()
+{
+    _detached = true;
+}
+
+/**
+ * @return the high-water mark of the painted stack of the Thread in bytes
+ */
+size_t Thread::getStackUsage() const
+{
+    return StackProfiler::measure(_stack, _stackSize);
+}
+
 /**
  * changed the state of the thread
  * @param state - new state
  */
 void Thread::setState(States state)
 {
+    uint64_t now = CycleClock::now();
+    // the counters of different cores may be a few ticks apart
+    uint64_t ticks = now > _stateSince ? now - _stateSince : 0;
+    _stats.stateTicks[_state] += ticks;
+    if (_state == RUNNING)
+    {
+        _vruntime += ticks * VRUNTIME_BASE_WEIGHT / _weight;
+    }
+    if (_state == READY && state == RUNNING)
+    {
+        uint64_t nsecs = CycleClock::toNsecs(ticks);
+        int bucket = 0;
+        if (nsecs >> READY_WAIT_MIN_SHIFT != 0)
+        {
+            bucket = 63 - __builtin_clzll(nsecs) - (READY_WAIT_MIN_SHIFT - 1);
+            bucket = bucket < READY_WAIT_BUCKETS ? bucket : READY_WAIT_BUCKETS - 1;
+        }
+        _stats.readyWaits[bucket]++;
+    }
+    _stateSince = now;
     this->_state = state;
 }
 
+/**
+ * @return The index of the worker the thread runs on, or of the worker whose ready queue it is in
+ */
+int Thread::getWorker() const
+{
+    return _worker;
+}
+
+/**
+ * change the worker of the thread
+ * @param worker - the index of the new worker
+ */
+void Thread::setWorker(int worker)
+{
+    this->_worker = worker;
+}
+
+/**
+ * @return The reasons the thread waits for, a combination of the WAIT_ flags, 0 if it does not
+ * wait for anything
+ */
+int Thread::getWaitReasons() const
+{
+    return _waitReasons;
+}
+
+/**
+ * add reasons the thread waits for
+ * @param reasons - a combination of the WAIT_ flags
+ */
+void Thread::addWaitReasons(int reasons)
+{
+    this->_waitReasons |= reasons;
+}
+
+/**
+ * remove reasons the thread waits for
+ * @param reasons - a combination of the WAIT_ flags
+ */
+void Thread::removeWaitReasons(int reasons)
+{
+    this->_waitReasons &= ~reasons;
+}
+
+/**
+ * @return The tick of its timer wheel the thread sleeps until
+ */
+uint64_t Thread::getWakeTick() const
+{
+    return _wakeTick;
+}
+
+/**
+ * change the tick of its timer wheel the thread sleeps until
+ * @param wakeTick - the new tick
+ */
+void Thread::setWakeTick(uint64_t wakeTick)
+{
+    this->_wakeTick = wakeTick;
+}
+
+/**
+ * @return The file descriptor the thread waits for
+ */
+int Thread::getIOFD() const
+{
+    return _ioFD;
+}
+
+/**
+ * change the file descriptor the thread waits for
+ * @param fd - the file descriptor
+ */
+void Thread::setIOFD(int fd)
+{
+    this->_ioFD = fd;
+}
+
+/**
+ * @return The queue of the synchronization object the thread waits in, nullptr if none
+ */
+ThreadQueue *Thread::getWaitQueue() const
+{
+    return _waitQueue;
+}
+
+/**
+ * change the queue of the synchronization object the thread waits in
+ * @param waitQueue - the queue, nullptr if none
+ */
+void Thread::setWaitQueue(ThreadQueue *waitQueue)
+{
+    this->_waitQueue = waitQueue;
+}
+
+/**
+ * @return Where the item the thread waits to send or receive through a channel is, nullptr once
+ * a peer took or delivered it
+ */
+void **Thread::getMessageSlot() const
+{
+    return _messageSlot;
+}
+
+/**
+ * change where the item the thread waits to send or receive through a channel is
+ * @param messageSlot - the item of a sender or the destination of a receiver, nullptr once a peer
+ * took or delivered it
+ */
+void Thread::setMessageSlot(void **messageSlot)
+{
+    this->_messageSlot = messageSlot;
+}
+
 /**
  * @return The amount of quantum the thread runs
  */
@@ -142,6 +390,42 @@ void Thread::setCountQuantums()
     this->_countQuantums++;
 }
 
+/**
+ * count a switch away from the thread
+ * @param preempted - true if its quantum ended, false if it gave up the CPU itself
+ */
+void Thread::countSwitch(bool preempted)
+{
+    if (preempted)
+    {
+        _stats.involuntarySwitches++;
+    }
+    else
+    {
+        _stats.voluntarySwitches++;
+    }
+}
+
+/**
+ * @param stats - where to store the statistics of the thread, including the time it has been in
+ * its current state so far
+ */
+void Thread::getStats(ThreadStats *stats) const
+{
+    *stats = _stats;
+    uint64_t now = CycleClock::now();
+    stats->stateTicks[_state] += now > _stateSince ? now - _stateSince : 0;
+}
+
+/**
+ * @return The virtual runtime of the thread - the CycleClock ticks it ran, each scaled by
+ * VRUNTIME_BASE_WEIGHT / the weight of its priority at the time
+ */
+uint64_t Thread::getVruntime() const
+{
+    return _vruntime;
+}
+
 
 
 
@@ -1,40 +1,111 @@
 #include <iostream>
-#include <setjmp.h>
 #include <signal.h>
+#include <stdint.h>
+#include "Context.h"
+#include "StackPool.h"
+#include "StackProfiler.h"
+#include "CycleClock.h"
 
 #ifndef THREAD_H
 #define THREAD_H
-//TODO change to 4096
-#define STACK_SIZE 16384 /* stack size per thread (in bytes) */
+#define STACK_SIZE 16384 /* default stack size per thread (in bytes), see uthread_spawn_stack */
 
 typedef enum States
 {
     RUNNING, BLOCKED, READY, TERMINATED
 } States;
 
+/* why a thread is BLOCKED. a thread may wait for several of them at once and stays BLOCKED until
+ * all of them are gone */
+#define WAIT_USER 1             /* blocked by uthread_block until uthread_resume */
+#define WAIT_SLEEP_QUANTUMS 2   /* sleeping in uthread_sleep */
+#define WAIT_SLEEP_USECS 4      /* sleeping in uthread_sleep_usecs */
+#define WAIT_SLEEP (WAIT_SLEEP_QUANTUMS | WAIT_SLEEP_USECS)
+#define WAIT_IO_READ 8          /* waiting for a file descriptor to be readable */
+#define WAIT_IO_WRITE 16        /* waiting for a file descriptor to be writable */
+#define WAIT_IO (WAIT_IO_READ | WAIT_IO_WRITE)
+#define WAIT_SYNC 32            /* waiting in the queue of a synchronization object, a channel or a
+                                 * thread it joins */
+
+#define STATES_COUNT 4
+#define READY_WAIT_BUCKETS 24   /* buckets of the histogram of the waits in the ready queue */
+#define READY_WAIT_MIN_SHIFT 7  /* the first bucket holds the waits below 2^7 nano-seconds */
+/* the weight of priority 0, every level above it weighs 5/4 more */
+#define VRUNTIME_BASE_WEIGHT 1024
+
+/**
+ * what a thread did since it was created. the first bucket of readyWaits counts the waits below
+ * 2^READY_WAIT_MIN_SHIFT nano-seconds, bucket i the waits of [2^(i+6), 2^(i+7)) nano-seconds, and
+ * the last bucket also all the longer ones
+ */
+struct ThreadStats
+{
+    uint64_t stateTicks[STATES_COUNT];  /* time in every state, in CycleClock ticks */
+    uint64_t voluntarySwitches;         /* switches away from the thread that it made itself */
+    uint64_t involuntarySwitches;       /* switches away from the thread at the end of a quantum */
+    uint32_t readyWaits[READY_WAIT_BUCKETS];
+};
+
+/**
+ * the function every spawned thread starts in, defined by the library. it completes the switch to
+ * the new thread and then calls its entry point
+ */
+void threadStart();
+
+class ThreadQueue;
+
 class Thread
 {
 private:
     int _ID;
-    int _quantum;
+    uint64_t _serial;
+    int64_t _quantum;
     int _priority;
     void (*_func)(void);
+    void (*_argFunc)(void *);
+    void *_arg;
     States _state;
     int _countQuantums;
     char *_stack;
+    size_t _stackSize;
+    StackPool *_stackPool;
+    bool _stackPainted;
+    bool _detached;
+    int _worker;
+    int _waitReasons;
+    uint64_t _wakeTick;
+    int _wheelSlot;
+    int _ioFD;
+    ThreadQueue *_waitQueue;
+    void **_messageSlot;
+    uint64_t _stateSince;
+    ThreadStats _stats;
+    uint64_t _weight;
+    uint64_t _vruntime;
+    int _readyIndex;
+    Thread *_queuePrev;
+    Thread *_queueNext;
+
+    friend class ThreadQueue;
+    friend class TimerWheel;
+    friend class CFSQueue;
 
 
 public:
-    sigjmp_buf env;
+    Context ctx;
 
 /**
  * Thread constructor
+ * @param stackPool - the pool to take the stack of the thread from if stackSize matches its size
+ * @param stackSize - the size of the stack of the thread, 0 for a thread that runs on the stack of
+ * the process (the main thread)
+ * @param paintStack - true to paint the stack so its high-water mark can be measured
  */
-    Thread(int ID, int quantum, int priority, void(*func)(void), States state = READY, int
-    countQuantums = 0);
+    Thread(int ID, int64_t quantum, int priority, void(*func)(void), StackPool *stackPool,
+           size_t stackSize, bool paintStack, States state = READY, int countQuantums = 0);
 
 /**
- * Thread destructor
+ * Thread destructor - returns the stack to its pool or unmaps it
  */
     ~Thread();
 
@@ -43,33 +114,184 @@ public:
  */
     int getID() const;
 
+/**
+ * @return The number of threads that were added before the Thread, which unlike its ID is never
+ * reused
+ */
+    uint64_t getSerial() const;
+
+/**
+ * @param serial - The number of threads that were added before the Thread
+ */
+    void setSerial(uint64_t serial);
+
+/**
+ * @return The entry point of the Thread
+ */
+    void (*getFunc() const)(void);
+
+/**
+ * @return The entry point of the Thread that takes an argument, nullptr if it starts in getFunc()
+ */
+    void (*getArgFunc() const)(void *);
+
+/**
+ * @return The argument of getArgFunc()
+ */
+    void *getArg() const;
+
+/**
+ * make the Thread start in a function that takes an argument instead of in getFunc()
+ * @param argFunc - the function
+ * @param arg - its argument
+ */
+    void setArgFunc(void (*argFunc)(void *), void *arg);
+
+/**
+ * keep a block at the top of the stack of the Thread, and start the Thread below it. must be
+ * called before the Thread first runs
+ * @param size - the size of the block in bytes
+ * @param align - the alignment of the block, a power of two
+ * @return the block
+ */
+    void *reserveStackTop(size_t size, size_t align);
+
 /**
  * @return The state of the Thread
  */
     States getState() const;
 
 /**
- * @return The quantum of the Thread
+ * @return The quantum of the Thread in nanoseconds
+ */
+    int64_t getQuantum() const;
+
+/**
+ * @return The priority of the Thread
  */
-    int getQuantum() const;
+    int getPriority() const;
 
 /**
- * change the priority of the thread
+ * change the priority of the thread and the quantum that comes with it
  * @param newPriority - new priority
+ * @param newQuantum - the quantum of the new priority in nanoseconds
  */
-    void setPriority(int newPriority);
+    void setPriority(int newPriority, int64_t newQuantum);
 
 /**
- * changed the state of the thread
+ * changed the state of the thread, adding the time since the last change to the time of the old
+ * state, and to the histogram of the waits if the thread was READY. the time RUNNING is added to
+ * the virtual runtime as well, divided by the weight of the priority of the thread
  * @param state - new state
  */
     void setState(States state);
 
 /**
- * @return The stack of the Thread
+ * @return The stack of the Thread, nullptr if it runs on the stack of the process or if there was
+ * no memory for its stack
  */
     char *getStack();
 
+/**
+ * @return The size of the stack of the Thread in bytes
+ */
+    size_t getStackSize() const;
+
+/**
+ * @return true if the stack of the Thread was painted when it was allocated, false otherwise
+ */
+    bool isStackPainted() const;
+
+/**
+ * @return the high-water mark of the painted stack of the Thread in bytes
+ */
+    size_t getStackUsage() const;
+
+/**
+ * @return true if the ID of the Thread is released as it terminates instead of kept for a join
+ */
+    bool isDetached() const;
+
+/**
+ * release the ID of the Thread as it terminates instead of keeping it for a join
+ */
+    void setDetached();
+
+/**
+ * @return The index of the worker the thread runs on, or of the worker whose ready queue it is in
+ */
+    int getWorker() const;
+
+/**
+ * change the worker of the thread
+ * @param worker - the index of the new worker
+ */
+    void setWorker(int worker);
+
+/**
+ * @return The reasons the thread waits for, a combination of the WAIT_ flags, 0 if it does not
+ * wait for anything
+ */
+    int getWaitReasons() const;
+
+/**
+ * add reasons the thread waits for
+ * @param reasons - a combination of the WAIT_ flags
+ */
+    void addWaitReasons(int reasons);
+
+/**
+ * remove reasons the thread waits for
+ * @param reasons - a combination of the WAIT_ flags
+ */
+    void removeWaitReasons(int reasons);
+
+/**
+ * @return The tick of its timer wheel the thread sleeps until
+ */
+    uint64_t getWakeTick() const;
+
+/**
+ * change the tick of its timer wheel the thread sleeps until
+ * @param wakeTick - the new tick
+ */
+    void setWakeTick(uint64_t wakeTick);
+
+/**
+ * @return The file descriptor the thread waits for
+ */
+    int getIOFD() const;
+
+/**
+ * change the file descriptor the thread waits for
+ * @param fd - the file descriptor
+ */
+    void setIOFD(int fd);
+
+/**
+ * @return The queue of the synchronization object the thread waits in, nullptr if none
+ */
+    ThreadQueue *getWaitQueue() const;
+
+/**
+ * change the queue of the synchronization object the thread waits in
+ * @param waitQueue - the queue, nullptr if none
+ */
+    void setWaitQueue(ThreadQueue *waitQueue);
+
+/**
+ * @return Where the item the thread waits to send or receive through a channel is, nullptr once
+ * a peer took or delivered it
+ */
+    void **getMessageSlot() const;
+
+/**
+ * change where the item the thread waits to send or receive through a channel is
+ * @param messageSlot - the item of a sender or the destination of a receiver, nullptr once a peer
+ * took or delivered it
+ */
+    void setMessageSlot(void **messageSlot);
+
 /**
  * @return The amount of quantum the thread runs
  */
@@ -80,6 +302,24 @@ public:
  */
     void setCountQuantums();
 
+/**
+ * count a switch away from the thread
+ * @param preempted - true if its quantum ended, false if it gave up the CPU itself
+ */
+    void countSwitch(bool preempted);
+
+/**
+ * @param stats - where to store the statistics of the thread, including the time it has been in
+ * its current state so far
+ */
+    void getStats(ThreadStats *stats) const;
+
+/**
+ * @return The virtual runtime of the thread - the CycleClock ticks it ran, each scaled by
+ * VRUNTIME_BASE_WEIGHT / the weight of its priority at the time
+ */
+    uint64_t getVruntime() const;
+
 };
 
 
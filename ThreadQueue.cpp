@@ -0,0 +1,91 @@
+#include "ThreadQueue.h"
+
+/**
+ * ThreadQueue constructor - creates an empty queue
+ */
+ThreadQueue::ThreadQueue() : _head(nullptr), _tail(nullptr)
+{}
+
+/**
+ * @return true if the queue has no threads, false otherwise
+ */
+bool ThreadQueue::empty() const
+{
+    return _head == nullptr;
+}
+
+/**
+ * @return the first thread in the queue, nullptr if the queue is empty
+ */
+Thread *ThreadQueue::front() const
+{
+    return _head;
+}
+
+/**
+ * add a thread to the end of the queue
+ * @param thread - the thread to add
+ */
+void ThreadQueue::pushBack(Thread *thread)
+{
+    thread->_queuePrev = _tail;
+    thread->_queueNext = nullptr;
+    if (_tail != nullptr)
+    {
+        _tail->_queueNext = thread;
+    }
+    else
+    {
+        _head = thread;
+    }
+    _tail = thread;
+}
+
+/**
+ * remove the first thread of the queue
+ * @return the removed thread, nullptr if the queue is empty
+ */
+Thread *ThreadQueue::popFront()
+{
+    Thread *first = _head;
+    if (first != nullptr)
+    {
+        remove(first);
+    }
+    return first;
+}
+
+/**
+ * remove a thread from the queue
+ * @param thread - the thread to remove, must be in this queue
+ */
+void ThreadQueue::remove(Thread *thread)
+{
+    if (thread->_queuePrev != nullptr)
+    {
+        thread->_queuePrev->_queueNext = thread->_queueNext;
+    }
+    else
+    {
+        _head = thread->_queueNext;
+    }
+    if (thread->_queueNext != nullptr)
+    {
+        thread->_queueNext->_queuePrev = thread->_queuePrev;
+    }
+    else
+    {
+        _tail = thread->_queuePrev;
+    }
+    thread->_queuePrev = nullptr;
+    thread->_queueNext = nullptr;
+}
+
+/**
+ * unlink all the threads in the queue
+ */
+void ThreadQueue::clear()
+{
+    while (popFront() != nullptr)
+    {}
+}
@@ -0,0 +1,58 @@
+#ifndef THREAD_QUEUE_H
+#define THREAD_QUEUE_H
+
+#include "Thread.h"
+
+/**
+ * FIFO queue of threads linked through the _queuePrev / _queueNext fields of Thread.
+ * A thread can be in at most one ThreadQueue at a time. All the operations are O(1)
+ * and never allocate memory.
+ */
+class ThreadQueue
+{
+public:
+
+/**
+ * ThreadQueue constructor - creates an empty queue
+ */
+    ThreadQueue();
+
+/**
+ * @return true if the queue has no threads, false otherwise
+ */
+    bool empty() const;
+
+/**
+ * @return the first thread in the queue, nullptr if the queue is empty
+ */
+    Thread *front() const;
+
+/**
+ * add a thread to the end of the queue
+ * @param thread - the thread to add
+ */
+    void pushBack(Thread *thread);
+
+/**
+ * remove the first thread of the queue
+ * @return the removed thread, nullptr if the queue is empty
+ */
+    Thread *popFront();
+
+/**
+ * remove a thread from the queue
+ * @param thread - the thread to remove, must be in this queue
+ */
+    void remove(Thread *thread);
+
+/**
+ * unlink all the threads in the queue
+ */
+    void clear();
+
+private:
+    Thread *_head;
+    Thread *_tail;
+};
+
+#endif
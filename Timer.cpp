@@ -0,0 +1,137 @@
+#include "Timer.h"
+#include <signal.h>
+#include <string.h>
+
+#ifdef UTHREADS_ITIMER
+#include <sys/time.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+ * Timer constructor - the timer does not run until create() and set() are called
+ */
+#ifdef UTHREADS_ITIMER
+Timer::Timer() : _armedNsecs(0)
+{}
+#else
+Timer::Timer() : _armedNsecs(0), _timerID(), _created(false)
+{}
+#endif
+
+/**
+ * Timer destructor - deletes the timer
+ */
+Timer::~Timer()
+{
+#ifndef UTHREADS_ITIMER
+    if (_created)
+    {
+        timer_delete(_timerID);
+    }
+#endif
+}
+
+#ifdef UTHREADS_ITIMER
+
+/**
+ * the virtual interval timer always exists and always sends SIGVTALRM to the process, so it can
+ * only serve a single kernel thread
+ * @param signal - unused
+ * @param threadClock - must be false
+ * @return true unless threadClock is true
+ */
+bool Timer::create(int signal, bool threadClock)
+{
+    (void) signal;
+    return !threadClock;
+}
+
+/**
+ * start a new quantum
+ * @param quantumNsecs - the length of the quantum in nanoseconds, rounded up to microseconds
+ * @param expired - true if the previous quantum just ended by the timer, in which case the timer
+ * is only re-armed if the length of the quantum changed
+ * @return true on success, false otherwise
+ */
+bool Timer::set(int64_t quantumNsecs, bool expired)
+{
+    if (expired && quantumNsecs == _armedNsecs)
+    {
+        return true;
+    }
+    int64_t usecs = (quantumNsecs + NSECS_PER_USEC - 1) / NSECS_PER_USEC;
+    struct itimerval timer;
+    timer.it_value.tv_sec = usecs / 1000000;        // first time interval, seconds part
+    timer.it_value.tv_usec = usecs % 1000000;        // first time interval, microseconds part
+    timer.it_interval = timer.it_value;              // following time intervals
+    if (setitimer(ITIMER_VIRTUAL, &timer, nullptr) != 0)
+    {
+        return false;
+    }
+    _armedNsecs = quantumNsecs;
+    return true;
+}
+
+#else
+
+/**
+ * create the timer on the CPU clock of the process, like ITIMER_VIRTUAL, or on the CPU clock of
+ * the calling kernel thread
+ * @param signal - the signal to send when a quantum ends
+ * @param threadClock - true to count the CPU time of the calling kernel thread and send the signal
+ * to it alone, false to count the CPU time of the process and send the signal to the process
+ * @return true on success, false otherwise
+ */
+bool Timer::create(int signal, bool threadClock)
+{
+    clockid_t clock = CLOCK_PROCESS_CPUTIME_ID;
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_SIGNAL;
+    event.sigev_signo = signal;
+    if (threadClock)
+    {
+        if (pthread_getcpuclockid(pthread_self(), &clock) != 0)
+        {
+            return false;
+        }
+        event.sigev_notify = SIGEV_THREAD_ID;
+        event._sigev_un._tid = (pid_t) syscall(SYS_gettid);
+    }
+    if (timer_create(clock, &event, &_timerID) != 0)
+    {
+        return false;
+    }
+    _created = true;
+    return true;
+}
+
+/**
+ * start a new quantum
+ * @param quantumNsecs - the length of the quantum in nanoseconds
+ * @param expired - true if the previous quantum just ended by the timer, in which case the timer
+ * is only re-armed if the length of the quantum changed
+ * @return true on success, false otherwise
+ */
+bool Timer::set(int64_t quantumNsecs, bool expired)
+{
+    if (expired && quantumNsecs == _armedNsecs)
+    {
+        return true;
+    }
+    struct itimerspec timer;
+    timer.it_value.tv_sec = quantumNsecs / NSECS_PER_SEC;
+    timer.it_value.tv_nsec = quantumNsecs % NSECS_PER_SEC;
+    timer.it_interval = timer.it_value;
+    if (timer_settime(_timerID, 0, &timer, nullptr) != 0)
+    {
+        return false;
+    }
+    _armedNsecs = quantumNsecs;
+    return true;
+}
+
+#endif
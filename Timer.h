@@ -0,0 +1,61 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define NSECS_PER_USEC 1000
+#define NSECS_PER_SEC 1000000000
+#define USECS_PER_SEC 1000000
+#define USECS_PER_MSEC 1000
+
+/**
+ * the preemption timer. it counts the CPU time of the process, or of one kernel thread, and
+ * sends a signal every quantum. the timer is periodic, so after it expires it is already running
+ * for the next quantum of the same length, and set() skips the system call when the next thread
+ * has that quantum.
+ * building with UTHREADS_ITIMER uses setitimer(ITIMER_VIRTUAL) instead of a POSIX timer, which
+ * limits the resolution to microseconds and supports only the process clock.
+ */
+class Timer
+{
+public:
+
+/**
+ * Timer constructor - the timer does not run until create() and set() are called
+ */
+    Timer();
+
+/**
+ * Timer destructor - deletes the timer
+ */
+    ~Timer();
+
+/**
+ * create the timer on the CPU clock of the process, like ITIMER_VIRTUAL, or on the CPU clock of
+ * the calling kernel thread
+ * @param signal - the signal to send when a quantum ends
+ * @param threadClock - true to count the CPU time of the calling kernel thread and send the signal
+ * to it alone, false to count the CPU time of the process and send the signal to the process
+ * @return true on success, false otherwise
+ */
+    bool create(int signal, bool threadClock);
+
+/**
+ * start a new quantum
+ * @param quantumNsecs - the length of the quantum in nanoseconds
+ * @param expired - true if the previous quantum just ended by the timer, in which case the timer
+ * is only re-armed if the length of the quantum changed
+ * @return true on success, false otherwise
+ */
+    bool set(int64_t quantumNsecs, bool expired);
+
+private:
+    int64_t _armedNsecs;
+#ifndef UTHREADS_ITIMER
+    timer_t _timerID;
+    bool _created;
+#endif
+};
+
+#endif
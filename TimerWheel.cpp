@@ -0,0 +1,214 @@
+#include "TimerWheel.h"
+
+#define TICK_MAX (~(uint64_t) 0)
+#define WHEEL_BITS (WHEEL_LEVELS * WHEEL_SLOT_BITS)
+
+/**
+ * @param tick - a tick
+ * @param level - a level of the wheel
+ * @return the digit of the tick at the level, which is its slot at that level
+ */
+static inline int digitAt(uint64_t tick, int level)
+{
+    return (int) (tick >> (level * WHEEL_SLOT_BITS)) & (WHEEL_SLOTS - 1);
+}
+
+/**
+ * TimerWheel constructor - creates an empty wheel at tick 0
+ */
+TimerWheel::TimerWheel() : _now(0), _count(0)
+{
+    for (int level = 0; level < WHEEL_LEVELS; ++level)
+    {
+        _busySlots[level] = 0;
+    }
+}
+
+/**
+ * @return true if no thread sleeps in the wheel, false otherwise
+ */
+bool TimerWheel::empty() const
+{
+    return _count == 0;
+}
+
+/**
+ * add a thread that sleeps until a tick
+ * @param thread - the thread to add
+ * @param wakeTick - the tick to wake the thread at
+ * @return true if the thread was added, false if the tick already passed and it was not
+ */
+bool TimerWheel::insert(Thread *thread, uint64_t wakeTick)
+{
+    if (wakeTick <= _now)
+    {
+        return false;
+    }
+    thread->_wakeTick = wakeTick;
+    place(thread);
+    _count++;
+    return true;
+}
+
+/**
+ * remove a thread before it wakes
+ * @param thread - the thread to remove, must be in this wheel
+ */
+void TimerWheel::remove(Thread *thread)
+{
+    if (thread->_wheelSlot == WHEEL_OVERFLOW_SLOT)
+    {
+        _overflow.remove(thread);
+    }
+    else
+    {
+        int level = thread->_wheelSlot / WHEEL_SLOTS;
+        int slot = thread->_wheelSlot % WHEEL_SLOTS;
+        _slots[level][slot].remove(thread);
+        if (_slots[level][slot].empty())
+        {
+            _busySlots[level] &= ~((uint64_t) 1 << slot);
+        }
+    }
+    _count--;
+}
+
+/**
+ * move the wheel forward and take out the threads whose wake tick passed
+ * @param now - the current tick, the wheel never moves backwards
+ * @param expired - the queue to add the woken threads to, in the order of their wake ticks
+ */
+void TimerWheel::advance(uint64_t now, ThreadQueue *expired)
+{
+    // jump from one busy slot to the next instead of walking through every tick
+    uint64_t next = nextTick();
+    while (next <= now)
+    {
+        _now = next;
+        if (!_overflow.empty() && (_now & (((uint64_t) 1 << WHEEL_BITS) - 1)) == 0)
+        {
+            cascade(&_overflow, expired);
+        }
+        // from the top level down, so the threads moved down are handled at this tick as well
+        for (int level = WHEEL_LEVELS - 1; level >= 0; --level)
+        {
+            uint64_t below = ((uint64_t) 1 << (level * WHEEL_SLOT_BITS)) - 1;
+            int slot = digitAt(_now, level);
+            if ((_now & below) == 0 && (_busySlots[level] & ((uint64_t) 1 << slot)) != 0)
+            {
+                _busySlots[level] &= ~((uint64_t) 1 << slot);
+                cascade(&_slots[level][slot], expired);
+            }
+        }
+        next = nextTick();
+    }
+    if (now > _now)
+    {
+        _now = now;
+    }
+}
+
+/**
+ * @return the next tick at which advance() has to do anything, which is not later than the
+ * earliest wake tick in the wheel. UINT64_MAX if the wheel is empty
+ */
+uint64_t TimerWheel::nextTick() const
+{
+    if (_count == 0)
+    {
+        return TICK_MAX;
+    }
+    uint64_t next = TICK_MAX;
+    for (int level = 0; level < WHEEL_LEVELS; ++level)
+    {
+        // the slots of a level that are still ahead in the current turn of the level above it
+        int digit = digitAt(_now, level);
+        uint64_t ahead = 0;
+        if (digit < WHEEL_SLOTS - 1)
+        {
+            ahead = _busySlots[level] & (~(uint64_t) 0 << (digit + 1));
+        }
+        if (ahead != 0)
+        {
+            int shift = (level + 1) * WHEEL_SLOT_BITS;
+            uint64_t turn = shift >= 64 ? 0 : (_now >> shift) << shift;
+            uint64_t slot = (uint64_t) __builtin_ctzll(ahead);
+            uint64_t tick = turn | (slot << (level * WHEEL_SLOT_BITS));
+            next = tick < next ? tick : next;
+        }
+    }
+    if (!_overflow.empty())
+    {
+        uint64_t tick = ((_now >> WHEEL_BITS) + 1) << WHEEL_BITS;
+        next = tick < next ? tick : next;
+    }
+    return next;
+}
+
+/**
+ * unlink all the threads in the wheel
+ */
+void TimerWheel::clear()
+{
+    for (int level = 0; level < WHEEL_LEVELS; ++level)
+    {
+        for (int slot = 0; slot < WHEEL_SLOTS; ++slot)
+        {
+            _slots[level][slot].clear();
+        }
+        _busySlots[level] = 0;
+    }
+    _overflow.clear();
+    _count = 0;
+}
+
+/**
+ * link a thread into the slot of its wake tick relative to _now, which must be before it
+ * @param thread - the thread
+ */
+void TimerWheel::place(Thread *thread)
+{
+    // the highest bit in which the wake tick differs from now picks the level
+    int level = (63 - __builtin_clzll(thread->_wakeTick ^ _now)) / WHEEL_SLOT_BITS;
+    if (level >= WHEEL_LEVELS)
+    {
+        thread->_wheelSlot = WHEEL_OVERFLOW_SLOT;
+        _overflow.pushBack(thread);
+        return;
+    }
+    int slot = digitAt(thread->_wakeTick, level);
+    thread->_wheelSlot = level * WHEEL_SLOTS + slot;
+    _slots[level][slot].pushBack(thread);
+    _busySlots[level] |= (uint64_t) 1 << slot;
+}
+
+/**
+ * take all the threads out of a slot, wake the ones whose tick came and place the others again
+ * @param slot - the slot
+ * @param expired - the queue to add the woken threads to
+ */
+void TimerWheel::cascade(ThreadQueue *slot, ThreadQueue *expired)
+{
+    // the threads are moved out first, since the overflow list may take some of them back
+    ThreadQueue moving;
+    Thread *thread = slot->popFront();
+    while (thread != nullptr)
+    {
+        moving.pushBack(thread);
+        thread = slot->popFront();
+    }
+    thread = moving.popFront();
+    while (thread != nullptr)
+    {
+        if (thread->_wakeTick <= _now)
+        {
+            _count--;
+            expired->pushBack(thread);
+        }
+        else
+        {
+            place(thread);
+        }
+        thread = moving.popFront();
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include "Thread.h"
+#include "ThreadQueue.h"
+
+#define WHEEL_LEVELS 6
+#define WHEEL_SLOT_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_SLOT_BITS)
+#define WHEEL_OVERFLOW_SLOT (WHEEL_LEVELS * WHEEL_SLOTS)
+
+/**
+ * hierarchical timing wheel of sleeping threads, in ticks of any unit that only grows.
+ * a thread is kept in the slot of the highest digit (WHEEL_SLOT_BITS bits per level) in which its
+ * wake tick differs from the current tick, and is moved down a level each time the wheel reaches
+ * that slot, so it is moved at most WHEEL_LEVELS times. threads that sleep past the range of the
+ * top level wait in an overflow list that is re-sorted once per turn of the top level.
+ * a bitmap per level finds the next busy slot, so advancing the wheel costs nothing for empty
+ * slots and O(1) for every thread that moves or wakes, however far the wheel is advanced.
+ * the threads are linked like in a ThreadQueue, so a sleeping thread must not be in any other
+ * ThreadQueue. all the operations never allocate memory.
+ */
+class TimerWheel
+{
+public:
+
+/**
+ * TimerWheel constructor - creates an empty wheel at tick 0
+ */
+    TimerWheel();
+
+/**
+ * @return true if no thread sleeps in the wheel, false otherwise
+ */
+    bool empty() const;
+
+/**
+ * add a thread that sleeps until a tick
+ * @param thread - the thread to add
+ * @param wakeTick - the tick to wake the thread at
+ * @return true if the thread was added, false if the tick already passed and it was not
+ */
+    bool insert(Thread *thread, uint64_t wakeTick);
+
+/**
+ * remove a thread before it wakes
+ * @param thread - the thread to remove, must be in this wheel
+ */
+    void remove(Thread *thread);
+
+/**
+ * move the wheel forward and take out the threads whose wake tick passed
+ * @param now - the current tick, the wheel never moves backwards
+ * @param expired - the queue to add the woken threads to, in the order of their wake ticks
+ */
+    void advance(uint64_t now, ThreadQueue *expired);
+
+/**
+ * @return the next tick at which advance() has to do anything, which is not later than the
+ * earliest wake tick in the wheel. UINT64_MAX if the wheel is empty
+ */
+    uint64_t nextTick() const;
+
+/**
+ * unlink all the threads in the wheel
+ */
+    void clear();
+
+private:
+    uint64_t _now;
+    int _count;
+    uint64_t _busySlots[WHEEL_LEVELS];
+    ThreadQueue _slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    ThreadQueue _overflow;
+
+/**
+ * link a thread into the slot of its wake tick relative to _now, which must be before it
+ * @param thread - the thread
+ */
+    void place(Thread *thread);
+
+/**
+ * take all the threads out of a slot, wake the ones whose tick came and place the others again
+ * @param slot - the slot
+ * @param expired - the queue to add the woken threads to
+ */
+    void cascade(ThreadQueue *slot, ThreadQueue *expired);
+};
+
+#endif
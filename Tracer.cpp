@@ -0,0 +1,144 @@
+#include "Tracer.h"
+#include "Thread.h"
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+#define NSECS_PER_USEC_F 1000.0
+
+static const char *SWITCH_OUT_NAMES[] = {"preempted", "yielded", "blocked", "terminated"};
+
+/**
+ * write the names of WAIT_ flags, separated by '|'
+ * @param file - the file to write to
+ * @param reasons - the flags
+ */
+static void writeReasons(FILE *file, int reasons)
+{
+    static const char *names[] = {"user", "sleep", "sleep", "read", "write", "sync"};
+    bool first = true;
+    for (int bit = 0; bit < (int) (sizeof(names) / sizeof(names[0])); ++bit)
+    {
+        if (reasons & (1 << bit))
+        {
+            fprintf(file, "%s%s", first ? "" : "|", names[bit]);
+            first = false;
+        }
+    }
+}
+
+/**
+ * Tracer constructor - creates an empty ring
+ * @param capacity - the number of events the ring keeps, rounded up to a power of two, positive
+ */
+Tracer::Tracer(int capacity) : _next(0)
+{
+    uint64_t size = 1;
+    while (size < (uint64_t) capacity)
+    {
+        size <<= 1;
+    }
+    _mask = size - 1;
+    _events = new TraceEvent[size];
+}
+
+/**
+ * Tracer destructor
+ */
+Tracer::~Tracer()
+{
+    delete[] _events;
+}
+
+/**
+ * record an event with the current time
+ * @param type - the kind of the event
+ * @param tid - the ID of the thread the event is about
+ * @param worker - the index of the worker the event happened on
+ * @param detail - the detail of the event, see TraceEvents
+ */
+void Tracer::record(TraceEvents type, int tid, int worker, int detail)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    TraceEvent *event = &_events[_next & _mask];
+    _next++;
+    event->nsecs = (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+    event->tid = tid;
+    event->worker = (int16_t) worker;
+    event->type = (int16_t) type;
+    event->detail = detail;
+}
+
+/**
+ * write the recorded events, oldest first, as a Chrome trace (JSON object format) that
+ * chrome://tracing and Perfetto load. every worker is a track on which the threads it ran are
+ * slices, and the other events are instant events on the track they happened on
+ * @param path - the file to write
+ * @param workers - the number of workers
+ * @return true on success, false if the file could not be written
+ */
+bool Tracer::dump(const char *path, int workers) const
+{
+    FILE *file = fopen(path, "w");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    uint64_t first = _next > _mask + 1 ? _next - (_mask + 1) : 0;
+    uint64_t startNsecs = first < _next ? _events[first & _mask].nsecs : 0;
+    // a slice whose dispatch was overwritten is left out, so every end has its begin
+    std::vector<bool> running(workers, false);
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    // the names of the tracks come first, so every event after them starts with a comma
+    for (int worker = 0; worker < workers; ++worker)
+    {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+                      "\"args\":{\"name\":\"worker %d\"}}", worker == 0 ? "" : ",\n", worker,
+                worker);
+    }
+    for (uint64_t i = first; i < _next; ++i)
+    {
+        const TraceEvent *event = &_events[i & _mask];
+        double usecs = (double) (event->nsecs - startNsecs) / NSECS_PER_USEC_F;
+        switch (event->type)
+        {
+            case TRACE_DISPATCH:
+                running[event->worker] = true;
+                fprintf(file, ",\n{\"name\":\"uthread %d\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":0,"
+                              "\"tid\":%d}", event->tid, usecs, event->worker);
+                break;
+            case TRACE_SWITCH_OUT:
+                if (!running[event->worker])
+                {
+                    break;
+                }
+                running[event->worker] = false;
+                fprintf(file, ",\n{\"ph\":\"E\",\"ts\":%.3f,\"pid\":0,\"tid\":%d,"
+                              "\"args\":{\"reason\":\"%s\"}}", usecs, event->worker,
+                        SWITCH_OUT_NAMES[event->detail]);
+                break;
+            case TRACE_SPAWN:
+                fprintf(file, ",\n{\"name\":\"spawn\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+                              "\"pid\":0,\"tid\":%d,\"args\":{\"uthread\":%d,\"priority\":%d}}",
+                        usecs, event->worker, event->tid, event->detail);
+                break;
+            case TRACE_BLOCK:
+            case TRACE_RESUME:
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,"
+                              "\"tid\":%d,\"args\":{\"uthread\":%d,\"reason\":\"",
+                        event->type == TRACE_BLOCK ? "block" : "resume", usecs, event->worker,
+                        event->tid);
+                writeReasons(file, event->detail);
+                fprintf(file, "\"}}");
+                break;
+            default:
+                fprintf(file, ",\n{\"name\":\"terminate\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+                              "\"pid\":0,\"tid\":%d,\"args\":{\"uthread\":%d}}",
+                        usecs, event->worker, event->tid);
+                break;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
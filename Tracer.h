@@ -0,0 +1,81 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <stdint.h>
+
+/* the kinds of events a Tracer records */
+typedef enum TraceEvents
+{
+    TRACE_SPAWN,        /* a thread was spawned, the detail is its priority */
+    TRACE_DISPATCH,     /* a thread started running on a worker */
+    TRACE_SWITCH_OUT,   /* a thread stopped running on a worker, the detail is a TraceSwitchOuts */
+    TRACE_BLOCK,        /* a thread got wait reasons, the detail is the WAIT_ flags it got */
+    TRACE_RESUME,       /* a thread became READY, the detail is the WAIT_ flags that ended */
+    TRACE_TERMINATE     /* a thread was terminated */
+} TraceEvents;
+
+/* why a thread stopped running */
+typedef enum TraceSwitchOuts
+{
+    TRACE_OUT_PREEMPTED, TRACE_OUT_YIELDED, TRACE_OUT_BLOCKED, TRACE_OUT_TERMINATED
+} TraceSwitchOuts;
+
+/**
+ * a recorded event
+ */
+struct TraceEvent
+{
+    uint64_t nsecs;
+    int tid;
+    int16_t worker;
+    int16_t type;
+    int detail;
+};
+
+/**
+ * ring buffer of scheduler events, allocated once with a power of two capacity. when it is full
+ * the oldest events are overwritten. recording takes a clock read and a few stores, never
+ * allocates memory and is async-signal-safe. the tracer itself is not synchronized, every call
+ * must hold the scheduler lock or run on the only worker.
+ */
+class Tracer
+{
+public:
+
+/**
+ * Tracer constructor - creates an empty ring
+ * @param capacity - the number of events the ring keeps, rounded up to a power of two, positive
+ */
+    explicit Tracer(int capacity);
+
+/**
+ * Tracer destructor
+ */
+    ~Tracer();
+
+/**
+ * record an event with the current time
+ * @param type - the kind of the event
+ * @param tid - the ID of the thread the event is about
+ * @param worker - the index of the worker the event happened on
+ * @param detail - the detail of the event, see TraceEvents
+ */
+    void record(TraceEvents type, int tid, int worker, int detail);
+
+/**
+ * write the recorded events, oldest first, as a Chrome trace (JSON object format) that
+ * chrome://tracing and Perfetto load. every worker is a track on which the threads it ran are
+ * slices, and the other events are instant events on the track they happened on
+ * @param path - the file to write
+ * @param workers - the number of workers
+ * @return true on success, false if the file could not be written
+ */
+    bool dump(const char *path, int workers) const;
+
+private:
+    TraceEvent *_events;
+    uint64_t _mask;
+    uint64_t _next;
+};
+
+#endif
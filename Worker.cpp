@@ -0,0 +1,103 @@
+#include "Worker.h"
+#include "StackPool.h"
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define IDLE_STACK_SIZE 16384
+
+/**
+ * Worker constructor
+ * @param index - the index of the worker, 0 for the kernel thread that called uthread_init
+ * @param readyQueue - the ready queue of the worker, owned by it from now on
+ */
+Worker::Worker(int index, ReadyQueue *readyQueue) : _index(index), _runningThread(nullptr),
+                                                    _readyQueue(readyQueue), _kernelTID(0),
+                                                    _idleStack(nullptr)
+{}
+
+/**
+ * Worker destructor - deletes the ready queue and unmaps the idle stack if there is one
+ */
+Worker::~Worker()
+{
+    delete _readyQueue;
+    if (_idleStack != nullptr)
+    {
+        StackPool::unmapStack(_idleStack, IDLE_STACK_SIZE);
+        _idleStack = nullptr;
+    }
+}
+
+/**
+ * give the worker an idle context with a stack of its own, for a worker whose kernel thread
+ * stack is used by a uthread
+ * @param entry - the function the idle context starts in, must never return
+ * @return true on success, false if there was no memory for the stack
+ */
+bool Worker::createIdleContext(void (*entry)(void))
+{
+    _idleStack = StackPool::mapStack(IDLE_STACK_SIZE);
+    if (_idleStack == nullptr)
+    {
+        return false;
+    }
+    contextInit(&idleCtx, _idleStack, IDLE_STACK_SIZE, entry);
+    return true;
+}
+
+/**
+ * @return the index of the worker
+ */
+int Worker::getIndex() const
+{
+    return _index;
+}
+
+/**
+ * @return the uthread the worker runs, nullptr if it is idle
+ */
+Thread *Worker::getRunningThread()
+{
+    return _runningThread;
+}
+
+/**
+ * change the uthread the worker runs
+ * @param thread - the new running uthread, nullptr if the worker becomes idle
+ */
+void Worker::setRunningThread(Thread *thread)
+{
+    _runningThread = thread;
+}
+
+/**
+ * @return the ready queue of the worker
+ */
+ReadyQueue *Worker::getReadyQueue()
+{
+    return _readyQueue;
+}
+
+/**
+ * @return the preemption timer of the worker
+ */
+Timer *Worker::getTimer()
+{
+    return &_timer;
+}
+
+/**
+ * @return the ID of the kernel thread of the worker, for sending it a signal
+ */
+pid_t Worker::getKernelTID() const
+{
+    return _kernelTID;
+}
+
+/**
+ * record the ID of the kernel thread of the worker, must be called by that kernel thread
+ */
+void Worker::setKernelTID()
+{
+    _kernelTID = (pid_t) syscall(SYS_gettid);
+}
@@ -0,0 +1,84 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <sys/types.h>
+#include "Context.h"
+#include "ReadyQueue.h"
+#include "Timer.h"
+
+/**
+ * a kernel thread that runs uthreads. every worker has its own ready queue, preemption timer and
+ * idle context - the context it waits for work in when none of the uthreads can run. the first
+ * worker is the kernel thread that called uthread_init, the others are pthreads started by it.
+ */
+class Worker
+{
+public:
+    Context idleCtx;
+
+/**
+ * Worker constructor
+ * @param index - the index of the worker, 0 for the kernel thread that called uthread_init
+ * @param readyQueue - the ready queue of the worker, owned by it from now on
+ */
+    Worker(int index, ReadyQueue *readyQueue);
+
+/**
+ * Worker destructor - deletes the ready queue and unmaps the idle stack if there is one
+ */
+    ~Worker();
+
+/**
+ * give the worker an idle context with a stack of its own, for a worker whose kernel thread
+ * stack is used by a uthread
+ * @param entry - the function the idle context starts in, must never return
+ * @return true on success, false if there was no memory for the stack
+ */
+    bool createIdleContext(void (*entry)(void));
+
+/**
+ * @return the index of the worker
+ */
+    int getIndex() const;
+
+/**
+ * @return the uthread the worker runs, nullptr if it is idle
+ */
+    Thread *getRunningThread();
+
+/**
+ * change the uthread the worker runs
+ * @param thread - the new running uthread, nullptr if the worker becomes idle
+ */
+    void setRunningThread(Thread *thread);
+
+/**
+ * @return the ready queue of the worker
+ */
+    ReadyQueue *getReadyQueue();
+
+/**
+ * @return the preemption timer of the worker
+ */
+    Timer *getTimer();
+
+/**
+ * @return the ID of the kernel thread of the worker, for sending it a signal
+ */
+    pid_t getKernelTID() const;
+
+/**
+ * record the ID of the kernel thread of the worker, must be called by that kernel thread
+ */
+    void setKernelTID();
+
+private:
+    int _index;
+    Thread *_runningThread;
+    ReadyQueue *_readyQueue;
+    Timer _timer;
+    pid_t _kernelTID;
+    char *_idleStack;
+};
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * Benchmark of the batch calls. For every batch size from 1 to BENCH_MAX_BATCH, doubled each
+ * time, it measures the cost per thread of
+ * - spawn: spawning a batch of threads with a loop of uthread_spawn_arg, and with
+ *   uthread_spawn_many. the threads are terminated outside the measured time
+ * - block_resume: blocking and resuming a batch of READY threads with loops of uthread_block and
+ *   uthread_resume, and with uthread_block_many and uthread_resume_many
+ * The results are printed as CSV, or as JSON with the json argument, one row per benchmark and
+ * batch size. The main thread has the highest priority and a quantum long enough that it is never
+ * preempted, so with one worker the spawned threads never run. With more workers the idle ones
+ * run them, and they block themselves.
+ *
+ * build: make bench, or
+ *        g++ -std=c++11 -O2 -I. bench/bench_batch.cpp libuthreads.a -o bench_batch -lpthread
+ * run:   ./bench_batch [csv|json] [workers]
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_QUANTUM_NSECS 1000000000
+#define BENCH_MAX_BATCH 1024
+#define BENCH_ITEMS 200000  /* threads spawned, or blocked and resumed, per batch size */
+#define THREAD_PRIORITY 0
+#define MAIN_PRIORITY 1
+
+static int tids[BENCH_MAX_BATCH];
+static bool json;
+static bool firstRow = true;
+
+/**
+ * @return the current monotonic time in nanoseconds
+ */
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * print one result as a CSV row or a JSON object
+ * @param name - the name of the benchmark
+ * @param batch - the batch size
+ * @param ops - the number of measured threads
+ * @param nsPerOp - nanoseconds per thread
+ */
+static void printResult(const char *name, int batch, long ops, double nsPerOp)
+{
+    if (json)
+    {
+        printf("%s\n  {\"benchmark\": \"%s\", \"batch\": %d, \"ops\": %ld, \"ns_per_op\": %.1f}",
+               firstRow ? "[" : ",", name, batch, ops, nsPerOp);
+    }
+    else
+    {
+        if (firstRow)
+        {
+            printf("benchmark,batch,ops,ns_per_op\n");
+        }
+        printf("%s,%d,%ld,%.1f\n", name, batch, ops, nsPerOp);
+    }
+    firstRow = false;
+    fflush(stdout);
+}
+
+/**
+ * entry point of the spawned threads, blocks itself if it ever gets to run
+ */
+void idleThread(void *)
+{
+    for (;;)
+    {
+        uthread_block(uthread_get_tid());
+    }
+}
+
+/**
+ * terminate the threads of tids
+ * @param count - the number of threads in tids
+ */
+static void terminateThreads(int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        uthread_terminate(tids[i]);
+    }
+}
+
+/**
+ * spawn batches of threads
+ * @param batch - the batch size
+ * @param many - true to spawn a batch with uthread_spawn_many, false with a loop
+ * @return nanoseconds per spawned thread
+ */
+static double benchSpawn(int batch, bool many)
+{
+    int rounds = BENCH_ITEMS / batch;
+    double elapsed = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        double start = nowNs();
+        if (many)
+        {
+            if (uthread_spawn_many(idleThread, nullptr, batch, THREAD_PRIORITY, tids) != 0)
+            {
+                exit(1);
+            }
+        }
+        else
+        {
+            for (int i = 0; i < batch; ++i)
+            {
+                tids[i] = uthread_spawn_arg(idleThread, nullptr, THREAD_PRIORITY);
+            }
+        }
+        elapsed += nowNs() - start;
+        terminateThreads(batch);
+    }
+    return elapsed / ((double) rounds * batch);
+}
+
+/**
+ * block and resume batches of READY threads
+ * @param batch - the batch size
+ * @param many - true to use uthread_block_many and uthread_resume_many, false loops
+ * @return nanoseconds per thread blocked and resumed
+ */
+static double benchBlockResume(int batch, bool many)
+{
+    if (uthread_spawn_many(idleThread, nullptr, batch, THREAD_PRIORITY, tids) != 0)
+    {
+        exit(1);
+    }
+    int rounds = BENCH_ITEMS / batch;
+    double start = nowNs();
+    for (int r = 0; r < rounds; ++r)
+    {
+        if (many)
+        {
+            uthread_block_many(tids, batch);
+            uthread_resume_many(tids, batch);
+        }
+        else
+        {
+            for (int i = 0; i < batch; ++i)
+            {
+                uthread_block(tids[i]);
+            }
+            for (int i = 0; i < batch; ++i)
+            {
+                uthread_resume(tids[i]);
+            }
+        }
+    }
+    double perThread = (nowNs() - start) / ((double) rounds * batch);
+    terminateThreads(batch);
+    return perThread;
+}
+
+int main(int argc, char **argv)
+{
+    json = argc > 1 && strcmp(argv[1], "json") == 0;
+    int workers = argc > 2 ? atoi(argv[2]) : 1;
+    int64_t quantum_nsecs[] = {BENCH_QUANTUM_NSECS, BENCH_QUANTUM_NSECS};
+    if (uthread_init_workers(quantum_nsecs, 2, workers, UTHREAD_POLICY_PRIORITY,
+                             BENCH_MAX_BATCH + 1) != 0)
+    {
+        return 1;
+    }
+    uthread_change_priority(0, MAIN_PRIORITY);
+    for (int batch = 1; batch <= BENCH_MAX_BATCH; batch *= 2)
+    {
+        long ops = (long) (BENCH_ITEMS / batch) * batch;
+        printResult("spawn_loop", batch, ops, benchSpawn(batch, false));
+        printResult("spawn_many", batch, ops, benchSpawn(batch, true));
+        printResult("block_resume_loop", batch, ops, benchBlockResume(batch, false));
+        printResult("block_resume_many", batch, ops, benchBlockResume(batch, true));
+    }
+    if (json)
+    {
+        printf("\n]\n");
+    }
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * Benchmark of the fairness and the overhead of a ready queue policy. For 10, 1000 and 100000
+ * runnable threads (up to the maximum) it measures
+ * - fairness_equal: Jain's fairness index of the CPU time the threads got, all of the same
+ *   priority, while they run bursts of 1 to BENCH_BURST_KINDS times BENCH_BURST_NSECS, by the
+ *   index of the thread, and yield after every burst. 1 is a perfectly even split, 1/threads is
+ *   one thread taking all of it. a FIFO gives every thread a share by the length of its bursts.
+ *   the BENCH_TRIM_PERCENT of the threads with the smallest shares and as many with the largest
+ *   ones are left out, since a thread whose kernel thread lost the CPU during a burst is charged
+ *   for the whole time, which alone would make the index of a short run far from 1
+ * - fairness_weighted: the same with every other thread one priority level higher, where the CPU
+ *   time of a thread is divided by the weight of its priority, 1.25 for the higher level, first
+ * - yield: the latency of a voluntary switch, while all the threads yield in turn, in nanoseconds
+ * The fairness is measured over voluntary switches since the CPU time timers of the kernel only
+ * fire on its scheduler ticks, so a quantum shorter than a tick lasts a tick. The quantums are
+ * long enough that no thread is preempted. The threads of the fairness benchmarks are spawned
+ * blocked and resumed together, and only the CPU time they got after that counts. The threads of
+ * all the benchmarks block themselves once the measurement ends, so the main thread gets the CPU
+ * back at once even if it ran ahead of them while it spawned them. The stacks have no guard
+ * pages, since a process may not have two mappings per thread. Every policy, or only the one
+ * that is given, runs in a child process of its own, since the library is initialized once per
+ * process. The results are printed as CSV, or as JSON with the json argument, one row per
+ * benchmark, policy and thread count, so the policies can be compared side by side.
+ *
+ * build: make bench, or
+ *        g++ -std=c++11 -O2 -I. bench/bench_cfs.cpp libuthreads.a -o bench_cfs -lpthread
+ * run:   ./bench_cfs [csv|json] [all|cfs|priority] [max_threads]
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <algorithm>
+
+#define BENCH_MAX_THREADS 100000
+#define BENCH_LEVEL_STEP 100
+#define BENCH_QUANTUM_NSECS 1000000000
+#define BENCH_BURST_NSECS 4000
+#define BENCH_BURST_KINDS 4
+#define BENCH_FAIR_BURSTS 8     /* bursts of the average length every thread gets on average */
+#define BENCH_TRIM_PERCENT 1
+#define BENCH_MIN_SWITCHES 200000
+#define BENCH_SWITCH_ROUNDS 2
+#define LOW_PRIORITY 0
+#define HIGH_PRIORITY 1
+#define MAIN_PRIORITY 2
+#define HIGH_WEIGHT 1.25        /* the weight of HIGH_PRIORITY relative to LOW_PRIORITY */
+#define POLICIES_COUNT 2
+
+static const char *const policyNames[POLICIES_COUNT] = {"cfs", "priority"};
+static const int policies[POLICIES_COUNT] = {UTHREAD_POLICY_CFS, UTHREAD_POLICY_PRIORITY};
+
+static int *tids;
+static uint64_t *runBefore;
+static double *shares;
+static int threadsCount;
+static uthread_sem_t measured;
+static const char *policyName;
+static bool json;
+static bool firstRow = true;
+
+static volatile bool stopped;
+static double deadline;
+static volatile int started;
+static volatile long switchesLeft;
+static double phaseStart;
+static double phaseEnd;
+
+/**
+ * @return the current monotonic time in nanoseconds
+ */
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * print one result as a CSV row or a JSON object
+ * @param name - the name of the benchmark
+ * @param threads - the number of threads that were runnable
+ * @param value - the fairness index, or nanoseconds per operation
+ */
+static void printResult(const char *name, int threads, double value)
+{
+    if (json)
+    {
+        printf("%s\n  {\"benchmark\": \"%s\", \"policy\": \"%s\", \"threads\": %d, "
+               "\"value\": %.4f}", firstRow ? "[" : ",", name, policyName, threads, value);
+    }
+    else
+    {
+        if (firstRow)
+        {
+            printf("benchmark,policy,threads,value\n");
+        }
+        printf("%s,%s,%d,%.4f\n", name, policyName, threads, value);
+    }
+    firstRow = false;
+    fflush(stdout);
+}
+
+/**
+ * @param tid - the ID of a thread
+ * @return the nanoseconds the thread has been RUNNING so far
+ */
+static uint64_t runNsecs(int tid)
+{
+    uthread_stats_t stats;
+    if (uthread_get_stats(tid, &stats) != 0)
+    {
+        exit(1);
+    }
+    return stats.run_nsecs;
+}
+
+/**
+ * terminate the threads of tids, from the last one
+ */
+static void terminateThreads()
+{
+    for (int i = threadsCount - 1; i >= 0; --i)
+    {
+        uthread_terminate(tids[i]);
+    }
+}
+
+/**
+ * entry point of the bursting threads. the first one that sees the deadline wakes the main thread,
+ * and every thread blocks itself once it sees that the measurement stopped
+ * @param arg - the index of the thread in tids
+ */
+void burstThread(void *arg)
+{
+    double burst = BENCH_BURST_NSECS * (1 + (long) arg % BENCH_BURST_KINDS);
+    for (;;)
+    {
+        if (stopped)
+        {
+            uthread_block(uthread_get_tid());
+            continue;
+        }
+        double end = nowNs() + burst;
+        while (nowNs() < end)
+        {}
+        if (end >= deadline && !stopped)
+        {
+            stopped = true;
+            uthread_sem_post(&measured);
+        }
+        uthread_yield();
+    }
+}
+
+/**
+ * all the threads run their bursts together for BENCH_FAIR_BURSTS average bursts each
+ * @param weighted - true to give every other thread HIGH_PRIORITY
+ * @return Jain's fairness index of the CPU time of the threads, divided by their weights
+ */
+static double benchFairness(bool weighted)
+{
+    // spawned blocked, so none of them runs before all of them can
+    for (int i = 0; i < threadsCount; ++i)
+    {
+        tids[i] = uthread_spawn_arg(burstThread, (void *) (long) i,
+                                    weighted && i % 2 == 1 ? HIGH_PRIORITY : LOW_PRIORITY);
+        if (tids[i] == -1 || uthread_block(tids[i]) != 0)
+        {
+            exit(1);
+        }
+        runBefore[i] = runNsecs(tids[i]);
+    }
+    stopped = false;
+    deadline = nowNs() + BENCH_FAIR_BURSTS * BENCH_BURST_NSECS * (BENCH_BURST_KINDS + 1) / 2.0 *
+                         threadsCount;
+    uthread_resume_many(tids, threadsCount);
+    uthread_sem_wait(&measured);
+    for (int i = 0; i < threadsCount; ++i)
+    {
+        shares[i] = (double) (runNsecs(tids[i]) - runBefore[i]);
+        shares[i] /= weighted && i % 2 == 1 ? HIGH_WEIGHT : 1;
+    }
+    terminateThreads();
+    std::sort(shares, shares + threadsCount);
+    int trim = threadsCount * BENCH_TRIM_PERCENT / 100;
+    double sum = 0;
+    double squares = 0;
+    for (int i = trim; i < threadsCount - trim; ++i)
+    {
+        sum += shares[i];
+        squares += shares[i] * shares[i];
+    }
+    return squares == 0 ? 0 : sum * sum / ((threadsCount - 2 * trim) * squares);
+}
+
+/**
+ * entry point of the yielding threads. the switches are counted once the last thread started, so
+ * every thread already runs on its stack, and every thread blocks itself once they were all made
+ */
+void yieldThread()
+{
+    if (++started == threadsCount)
+    {
+        phaseStart = nowNs();
+    }
+    for (;;)
+    {
+        uthread_yield();
+        if (stopped)
+        {
+            uthread_block(uthread_get_tid());
+        }
+        else if (started == threadsCount && --switchesLeft == 0)
+        {
+            phaseEnd = nowNs();
+            stopped = true;
+            uthread_sem_post(&measured);
+        }
+    }
+}
+
+/**
+ * all the threads yield in turn
+ * @return nanoseconds per voluntary switch
+ */
+static double benchYield()
+{
+    long ops = (long) threadsCount * BENCH_SWITCH_ROUNDS;
+    ops = ops < BENCH_MIN_SWITCHES ? BENCH_MIN_SWITCHES : ops;
+    started = 0;
+    switchesLeft = ops;
+    stopped = false;
+    for (int i = 0; i < threadsCount; ++i)
+    {
+        tids[i] = uthread_spawn(yieldThread, LOW_PRIORITY);
+        if (tids[i] == -1)
+        {
+            exit(1);
+        }
+    }
+    uthread_sem_wait(&measured);
+    terminateThreads();
+    return (phaseEnd - phaseStart) / ops;
+}
+
+/**
+ * run all the benchmarks with one policy and exit the process
+ * @param policy - the ready queue policy
+ * @param maxThreads - the most threads to run
+ */
+static void runPolicy(int policy, int maxThreads)
+{
+    int64_t quantum_nsecs[] = {BENCH_QUANTUM_NSECS, BENCH_QUANTUM_NSECS, BENCH_QUANTUM_NSECS};
+    if (uthread_init_workers(quantum_nsecs, 3, 1, policy, maxThreads + 1) != 0)
+    {
+        exit(1);
+    }
+    uthread_stack_guards(0);
+    uthread_change_priority(0, MAIN_PRIORITY);
+    uthread_sem_init(&measured, 0);
+    tids = new int[maxThreads];
+    runBefore = new uint64_t[maxThreads];
+    shares = new double[maxThreads];
+
+    for (long count = 10; ; count *= BENCH_LEVEL_STEP)
+    {
+        threadsCount = count < maxThreads ? (int) count : maxThreads;
+        printResult("fairness_equal", threadsCount, benchFairness(false));
+        printResult("fairness_weighted", threadsCount, benchFairness(true));
+        printResult("yield", threadsCount, benchYield());
+        if (threadsCount == maxThreads)
+        {
+            break;
+        }
+    }
+    delete[] tids;
+    delete[] runBefore;
+    delete[] shares;
+    uthread_terminate(0);
+}
+
+int main(int argc, char **argv)
+{
+    json = argc > 1 && strcmp(argv[1], "json") == 0;
+    const char *only = argc > 2 ? argv[2] : "all";
+    int maxThreads = argc > 3 ? atoi(argv[3]) : BENCH_MAX_THREADS;
+    if (maxThreads < 1)
+    {
+        return 1;
+    }
+    for (int i = 0; i < POLICIES_COUNT; ++i)
+    {
+        if (strcmp(only, "all") != 0 && strcmp(only, policyNames[i]) != 0)
+        {
+            continue;
+        }
+        policyName = policyNames[i];
+        pid_t child = fork();
+        if (child == 0)
+        {
+            runPolicy(policies[i], maxThreads);
+        }
+        int status;
+        if (child == -1 || waitpid(child, &status, 0) != child || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0)
+        {
+            return 1;
+        }
+        firstRow = false;
+    }
+    if (firstRow)
+    {
+        return 1;   // an unknown policy
+    }
+    if (json)
+    {
+        printf("\n]\n");
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Stress benchmark for large numbers of threads. It spawns a million threads (or the count given
+ * on the command line) that are all alive at once, lets every one of them yield BENCH_YIELDS
+ * times, so each round of switches goes through all of them, and terminates them once they
+ * blocked themselves. It reports the time per spawn, per switch and per termination, and the
+ * memory the threads take while they are all alive, per thread: the resident memory and the
+ * address space.
+ * The threads have a quantum long enough that they are never preempted, and the main thread
+ * waits on semaphores that the last thread to start and the last thread to finish post. The
+ * stacks have no guard pages, since a process may not have two mappings per thread.
+ *
+ * build: g++ -std=c++11 -O2 -I. bench/bench_million.cpp libuthreads.a -o bench_million -lpthread
+ * run:   ./bench_million [threads]
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_QUANTUM_NSECS 1000000000
+#define BENCH_THREADS 1000000
+#define BENCH_YIELDS 4
+
+static int threadsCount;
+static int started;
+static int finished;
+static double switchesStart;
+static double switchesEnd;
+static uthread_sem_t allStarted;
+static uthread_sem_t allFinished;
+
+/**
+ * @return the current monotonic time in nanoseconds
+ */
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @param resident - where to store the resident memory of the process in bytes
+ * @param virt - where to store the address space of the process in bytes
+ */
+static void memoryUsage(long *resident, long *virt)
+{
+    long pageSize = sysconf(_SC_PAGESIZE);
+    long pages = 0;
+    long residentPages = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr || fscanf(statm, "%ld %ld", &pages, &residentPages) != 2)
+    {
+        pages = 0;
+        residentPages = 0;
+    }
+    if (statm != nullptr)
+    {
+        fclose(statm);
+    }
+    *resident = residentPages * pageSize;
+    *virt = pages * pageSize;
+}
+
+/**
+ * entry point of the threads: yields BENCH_YIELDS times and blocks itself until it is terminated.
+ * the threads run on one worker, so the counters need no atomics
+ */
+void stressThread()
+{
+    if (++started == threadsCount)
+    {
+        uthread_sem_post(&allStarted);
+    }
+    if (started == 1)
+    {
+        switchesStart = nowNs();
+    }
+    for (int i = 0; i < BENCH_YIELDS; ++i)
+    {
+        uthread_yield();
+    }
+    if (++finished == threadsCount)
+    {
+        switchesEnd = nowNs();
+        uthread_sem_post(&allFinished);
+    }
+    uthread_block(uthread_get_tid());
+}
+
+int main(int argc, char **argv)
+{
+    threadsCount = argc > 1 ? atoi(argv[1]) : BENCH_THREADS;
+    int64_t quantum_nsecs[] = {BENCH_QUANTUM_NSECS};
+    if (threadsCount <= 0 || uthread_init_workers(quantum_nsecs, 1, 1, UTHREAD_POLICY_PRIORITY,
+                                                  threadsCount + 1) != 0)
+    {
+        return 1;
+    }
+    uthread_stack_guards(0);
+    uthread_sem_init(&allStarted, 0);
+    uthread_sem_init(&allFinished, 0);
+    long residentBefore, virtBefore, residentAfter, virtAfter;
+    memoryUsage(&residentBefore, &virtBefore);
+
+    double start = nowNs();
+    for (int i = 0; i < threadsCount; ++i)
+    {
+        if (uthread_spawn(stressThread, 0) == -1)
+        {
+            printf("spawn failed after %d threads\n", i);
+            return 1;
+        }
+    }
+    double spawnNs = (nowNs() - start) / threadsCount;
+
+    // every thread is on its stack and waits in the first yield once the last one started
+    uthread_sem_wait(&allStarted);
+    memoryUsage(&residentAfter, &virtAfter);
+    uthread_sem_wait(&allFinished);
+    double switchNs = (switchesEnd - switchesStart) / ((double) threadsCount * (BENCH_YIELDS + 1));
+
+    start = nowNs();
+    for (int tid = 1; tid <= threadsCount; ++tid)
+    {
+        uthread_terminate(tid);
+    }
+    double terminateNs = (nowNs() - start) / threadsCount;
+
+    printf("threads:          %d\n", threadsCount);
+    printf("spawn:            %.1f ns\n", spawnNs);
+    printf("switch:           %.1f ns\n", switchNs);
+    printf("terminate:        %.1f ns\n", terminateNs);
+    printf("resident/thread:  %.0f bytes\n",
+           (double) (residentAfter - residentBefore) / threadsCount);
+    printf("address/thread:   %.0f bytes\n", (double) (virtAfter - virtBefore) / threadsCount);
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,329 @@
+/*
+ * Scaling benchmark of the costs of the scheduler. For every thread count from 2 up to the
+ * maximum, multiplied by BENCH_LEVEL_STEP each time, it measures with that many threads alive:
+ * - yield: the latency of a voluntary switch, while all the threads yield in turn
+ * - preempt: the latency of a preemptive switch, from the last instruction of a spinning thread
+ *   whose quantum ended to the first instruction of the next one, timer signal included. it is
+ *   the median of the samples, since a kernel thread that loses the CPU adds milliseconds to one
+ * - spawn_terminate: the time of a uthread_spawn + uthread_terminate pair, spawning all the
+ *   threads and then terminating all of them
+ * - block_resume: the round trip of two threads that resume each other and block themselves,
+ *   while all the other threads wait in the ready queue
+ * The results are printed as CSV, or as JSON with the json argument, one row per benchmark and
+ * thread count, so the runs of two versions of the library can be compared with diff.
+ * The main thread has the highest priority and waits on a semaphore while the measured threads
+ * run, so it gets the CPU back as soon as they post it, and terminates them. The stacks have no
+ * guard pages, since a process may not have two mappings per thread.
+ *
+ * build: make bench, or
+ *        g++ -std=c++11 -O2 -I. bench/bench_scaling.cpp libuthreads.a -o bench_scaling -lpthread
+ * run:   ./bench_scaling [csv|json] [max_threads]
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+#define BENCH_MAX_THREADS (1 << 20)
+#define BENCH_LEVEL_STEP 8
+#define PREEMPT_QUANTUM_NSECS 100000
+#define LONG_QUANTUM_NSECS 1000000000
+#define PREEMPT_PRIORITY 0  /* the spinning threads, with a short quantum */
+#define BENCH_PRIORITY 1    /* the other measured threads, which are never preempted */
+#define MAIN_PRIORITY 2
+#define BENCH_MIN_SWITCHES 200000   /* voluntary switches per thread count, at least */
+#define BENCH_SWITCH_ROUNDS 2       /* voluntary switches per thread, at least */
+#define BENCH_PREEMPT_SAMPLES 1000
+#define BENCH_MIN_SPAWNS 100000
+#define BENCH_ROUND_TRIPS 100000
+
+static int *tids;
+static int threadsCount;
+static uthread_sem_t measured;
+static bool json;
+static bool firstRow = true;
+
+static volatile int started;
+static volatile long switchesLeft;
+static double phaseStart;
+static double phaseEnd;
+
+static volatile int lastTid;
+static volatile double *lastSeen;
+static double latencies[BENCH_PREEMPT_SAMPLES];
+static volatile int samplesLeft;
+
+static int pingTid, pongTid;
+static volatile bool pingPongDone;
+
+/**
+ * @return the current monotonic time in nanoseconds
+ */
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * print one result as a CSV row or a JSON object
+ * @param name - the name of the benchmark
+ * @param threads - the number of threads that were alive
+ * @param ops - the number of measured operations
+ * @param nsPerOp - nanoseconds per operation
+ */
+static void printResult(const char *name, int threads, long ops, double nsPerOp)
+{
+    if (json)
+    {
+        printf("%s\n  {\"benchmark\": \"%s\", \"threads\": %d, \"ops\": %ld, \"ns_per_op\": %.1f}",
+               firstRow ? "[" : ",", name, threads, ops, nsPerOp);
+    }
+    else
+    {
+        if (firstRow)
+        {
+            printf("benchmark,threads,ops,ns_per_op\n");
+        }
+        printf("%s,%d,%ld,%.1f\n", name, threads, ops, nsPerOp);
+    }
+    firstRow = false;
+    fflush(stdout);
+}
+
+/**
+ * spawn threads into tids, starting at the given index
+ * @param f - the entry point of the threads
+ * @param priority - their priority
+ * @param from - the first index of tids to fill
+ * @param to - the index of tids after the last one to fill
+ */
+static void spawnThreads(void (*f)(void), int priority, int from, int to)
+{
+    for (int i = from; i < to; ++i)
+    {
+        tids[i] = uthread_spawn(f, priority);
+        if (tids[i] == -1)
+        {
+            exit(1);
+        }
+    }
+}
+
+/**
+ * terminate the threads of tids, from the last one
+ * @param count - the number of threads in tids
+ */
+static void terminateThreads(int count)
+{
+    for (int i = count - 1; i >= 0; --i)
+    {
+        uthread_terminate(tids[i]);
+    }
+}
+
+/**
+ * entry point of the threads that wait in the ready queue, blocks itself if it ever gets to run
+ */
+void idleThread()
+{
+    for (;;)
+    {
+        uthread_block(uthread_get_tid());
+    }
+}
+
+/**
+ * entry point of the yielding threads. the switches are counted once the last thread started, so
+ * every thread already runs on its stack
+ */
+void yieldThread()
+{
+    if (++started == threadsCount)
+    {
+        phaseStart = nowNs();
+    }
+    for (;;)
+    {
+        uthread_yield();
+        if (started == threadsCount && --switchesLeft == 0)
+        {
+            phaseEnd = nowNs();
+            uthread_sem_post(&measured);
+        }
+    }
+}
+
+/**
+ * all the threads yield in turn
+ * @param ops - where to store the number of measured operations
+ * @return nanoseconds per voluntary switch
+ */
+static double benchYield(long *ops)
+{
+    *ops = (long) threadsCount * BENCH_SWITCH_ROUNDS;
+    *ops = *ops < BENCH_MIN_SWITCHES ? BENCH_MIN_SWITCHES : *ops;
+    started = 0;
+    switchesLeft = *ops;
+    spawnThreads(yieldThread, BENCH_PRIORITY, 0, threadsCount);
+    uthread_sem_wait(&measured);
+    terminateThreads(threadsCount);
+    return (phaseEnd - phaseStart) / *ops;
+}
+
+/**
+ * entry point of the spinning threads. a thread that sees that another one ran since its last
+ * look at the clock takes the time from the last look of the other one as the latency of a
+ * preemptive switch. every thread has its own last look, since it may be preempted between
+ * reading the clock and storing the time
+ */
+void spinThread()
+{
+    int self = uthread_get_tid();
+    for (;;)
+    {
+        if (lastTid != self)
+        {
+            double now = nowNs();
+            // the switches from the main thread are not preemptive
+            if (lastTid != 0 && samplesLeft > 0)
+            {
+                latencies[--samplesLeft] = now - lastSeen[lastTid];
+                if (samplesLeft == 0)
+                {
+                    uthread_sem_post(&measured);
+                }
+            }
+            lastTid = self;
+        }
+        lastSeen[self] = nowNs();
+    }
+}
+
+/**
+ * all the threads spin until their quantum ends
+ * @param ops - where to store the number of measured operations
+ * @return the median nanoseconds of a preemptive switch
+ */
+static double benchPreempt(long *ops)
+{
+    *ops = BENCH_PREEMPT_SAMPLES;
+    lastTid = 0;
+    samplesLeft = BENCH_PREEMPT_SAMPLES;
+    spawnThreads(spinThread, PREEMPT_PRIORITY, 0, threadsCount);
+    uthread_sem_wait(&measured);
+    terminateThreads(threadsCount);
+    std::sort(latencies, latencies + BENCH_PREEMPT_SAMPLES);
+    return latencies[BENCH_PREEMPT_SAMPLES / 2];
+}
+
+/**
+ * spawn all the threads and terminate them, as many times as it takes to make BENCH_MIN_SPAWNS
+ * @param ops - where to store the number of measured operations
+ * @return nanoseconds per spawn + terminate pair
+ */
+static double benchSpawnTerminate(long *ops)
+{
+    int rounds = (BENCH_MIN_SPAWNS + threadsCount - 1) / threadsCount;
+    *ops = (long) rounds * threadsCount;
+    double start = nowNs();
+    for (int r = 0; r < rounds; ++r)
+    {
+        spawnThreads(idleThread, PREEMPT_PRIORITY, 0, threadsCount);
+        terminateThreads(threadsCount);
+    }
+    return (nowNs() - start) / *ops;
+}
+
+/**
+ * resume the other thread of the ping pong pair and block this one, BENCH_ROUND_TRIPS times
+ */
+void pingThread()
+{
+    for (int i = 0; i < BENCH_ROUND_TRIPS; ++i)
+    {
+        uthread_resume(pongTid);
+        uthread_block(pingTid);
+    }
+    phaseEnd = nowNs();
+    pingPongDone = true;
+    uthread_sem_post(&measured);
+    uthread_block(pingTid);
+}
+
+/**
+ * the other thread of the ping pong pair
+ */
+void pongThread()
+{
+    while (!pingPongDone)
+    {
+        uthread_resume(pingTid);
+        uthread_block(pongTid);
+    }
+}
+
+/**
+ * two threads block themselves in turn, while the other threads wait in the ready queue below them
+ * @param ops - where to store the number of measured operations
+ * @return nanoseconds per round trip of two switches
+ */
+static double benchBlockResume(long *ops)
+{
+    *ops = BENCH_ROUND_TRIPS;
+    pingPongDone = false;
+    spawnThreads(idleThread, PREEMPT_PRIORITY, 2, threadsCount);
+    phaseStart = nowNs();
+    pingTid = tids[0] = uthread_spawn(pingThread, BENCH_PRIORITY);
+    pongTid = tids[1] = uthread_spawn(pongThread, BENCH_PRIORITY);
+    uthread_sem_wait(&measured);
+    terminateThreads(threadsCount);
+    return (phaseEnd - phaseStart) / *ops;
+}
+
+int main(int argc, char **argv)
+{
+    json = argc > 1 && strcmp(argv[1], "json") == 0;
+    int maxThreads = argc > 2 ? atoi(argv[2]) : BENCH_MAX_THREADS;
+    int64_t quantum_nsecs[] = {PREEMPT_QUANTUM_NSECS, LONG_QUANTUM_NSECS, LONG_QUANTUM_NSECS};
+    if (maxThreads < 2 || uthread_init_workers(quantum_nsecs, 3, 1, UTHREAD_POLICY_PRIORITY,
+                                               maxThreads + 1) != 0)
+    {
+        return 1;
+    }
+    uthread_stack_guards(0);
+    uthread_change_priority(0, MAIN_PRIORITY);
+    uthread_sem_init(&measured, 0);
+    tids = new int[maxThreads];
+    lastSeen = new double[maxThreads + 1];
+
+    for (long count = 2; ; count *= BENCH_LEVEL_STEP)
+    {
+        threadsCount = count < maxThreads ? (int) count : maxThreads;
+        long ops;
+        double nsPerOp = benchYield(&ops);
+        printResult("yield", threadsCount, ops, nsPerOp);
+        nsPerOp = benchPreempt(&ops);
+        printResult("preempt", threadsCount, ops, nsPerOp);
+        nsPerOp = benchSpawnTerminate(&ops);
+        printResult("spawn_terminate", threadsCount, ops, nsPerOp);
+        nsPerOp = benchBlockResume(&ops);
+        printResult("block_resume", threadsCount, ops, nsPerOp);
+        if (threadsCount == maxThreads)
+        {
+            break;
+        }
+    }
+    if (json)
+    {
+        printf("\n]\n");
+    }
+    delete[] tids;
+    delete[] lastSeen;
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * Microbenchmark for the thread table hot paths: uthread_spawn + uthread_terminate,
+ * uthread_block + uthread_resume of READY threads and uthread_get_quantums lookups, and for
+ * voluntary context switches between two threads that block themselves in turn or yield.
+ * The main thread has a short quantum so that it is preempted while it waits for the spawned
+ * threads, which have a quantum long enough that they are never preempted.
+ *
+ * build: g++ -std=c++11 -O2 -I. bench/bench_threads.cpp libuthreads.a -o bench_threads
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_QUANTUM 1000000000
+#define MAIN_QUANTUM 10000
+#define BENCH_ROUNDS 20000
+#define BENCH_THREADS (MAX_THREAD_NUM - 1)
+#define BENCH_SWITCHES 1000000
+
+static int pingTid, pongTid;
+static volatile bool pingPongDone;
+static volatile int finished; /* the measured threads that are done, polled by the main thread */
+
+/**
+ * entry point of the spawned threads, blocks itself if it ever gets to run
+ */
+void idleThread()
+{
+    for (;;)
+    {
+        uthread_block(uthread_get_tid());
+    }
+}
+
+/**
+ * @return the current monotonic time in nanoseconds
+ */
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * spawn and terminate BENCH_THREADS threads BENCH_ROUNDS times
+ * @return nanoseconds per spawn + terminate pair
+ */
+static double benchSpawnTerminate()
+{
+    double start = nowNs();
+    for (int r = 0; r < BENCH_ROUNDS; ++r)
+    {
+        for (int i = 0; i < BENCH_THREADS; ++i)
+        {
+            uthread_spawn(idleThread, 0);
+        }
+        for (int tid = BENCH_THREADS; tid > 0; --tid)
+        {
+            uthread_terminate(tid);
+        }
+    }
+    return (nowNs() - start) / ((double) BENCH_ROUNDS * BENCH_THREADS);
+}
+
+/**
+ * block and resume each of BENCH_THREADS READY threads BENCH_ROUNDS times
+ * @return nanoseconds per block + resume pair
+ */
+static double benchBlockResume()
+{
+    for (int i = 0; i < BENCH_THREADS; ++i)
+    {
+        uthread_spawn(idleThread, 0);
+    }
+    double start = nowNs();
+    for (int r = 0; r < BENCH_ROUNDS; ++r)
+    {
+        for (int tid = 1; tid <= BENCH_THREADS; ++tid)
+        {
+            uthread_block(tid);
+        }
+        for (int tid = 1; tid <= BENCH_THREADS; ++tid)
+        {
+            uthread_resume(tid);
+        }
+    }
+    double perPair = (nowNs() - start) / ((double) BENCH_ROUNDS * BENCH_THREADS);
+    for (int tid = 1; tid <= BENCH_THREADS; ++tid)
+    {
+        uthread_terminate(tid);
+    }
+    return perPair;
+}
+
+/**
+ * look up every thread BENCH_ROUNDS times through uthread_get_quantums
+ * @return nanoseconds per lookup
+ */
+static double benchLookup()
+{
+    for (int i = 0; i < BENCH_THREADS; ++i)
+    {
+        uthread_spawn(idleThread, 0);
+    }
+    long sum = 0;
+    double start = nowNs();
+    for (int r = 0; r < BENCH_ROUNDS; ++r)
+    {
+        for (int tid = 0; tid <= BENCH_THREADS; ++tid)
+        {
+            sum += uthread_get_quantums(tid);
+        }
+    }
+    double perLookup = (nowNs() - start) / ((double) BENCH_ROUNDS * (BENCH_THREADS + 1));
+    for (int tid = 1; tid <= BENCH_THREADS; ++tid)
+    {
+        uthread_terminate(tid);
+    }
+    return sum < 0 ? 0 : perLookup;
+}
+
+/**
+ * resume the other thread of the ping pong pair and block this one, until BENCH_SWITCHES switches
+ */
+void pingThread()
+{
+    for (int i = 0; i < BENCH_SWITCHES / 2; ++i)
+    {
+        uthread_resume(pongTid);
+        uthread_block(pingTid);
+    }
+    pingPongDone = true;
+    uthread_resume(pongTid);
+    finished++;
+    uthread_terminate(pingTid);
+}
+
+/**
+ * the other thread of the ping pong pair
+ */
+void pongThread()
+{
+    while (!pingPongDone)
+    {
+        uthread_resume(pingTid);
+        uthread_block(pongTid);
+    }
+    finished++;
+    uthread_terminate(pongTid);
+}
+
+/**
+ * two threads with a higher priority than the main thread block themselves in turn
+ * @return nanoseconds per voluntary switch (including its block + resume calls)
+ */
+static double benchSwitch()
+{
+    pingPongDone = false;
+    finished = 0;
+    double start = nowNs();
+    pingTid = uthread_spawn(pingThread, 1);
+    pongTid = uthread_spawn(pongThread, 1);
+    // the main thread runs again only after both threads are done
+    while (finished < 2)
+    {}
+    return (nowNs() - start) / BENCH_SWITCHES;
+}
+
+/**
+ * yield until BENCH_SWITCHES yields were made by the two yielding threads together
+ */
+void yieldThread()
+{
+    for (int i = 0; i < BENCH_SWITCHES / 2; ++i)
+    {
+        uthread_yield();
+    }
+    finished++;
+    uthread_terminate(uthread_get_tid());
+}
+
+/**
+ * two threads with a higher priority than the main thread yield to each other
+ * @return nanoseconds per uthread_yield
+ */
+static double benchYield()
+{
+    finished = 0;
+    double start = nowNs();
+    uthread_spawn(yieldThread, 1);
+    uthread_spawn(yieldThread, 1);
+    // the main thread runs again only after both threads are done
+    while (finished < 2)
+    {}
+    return (nowNs() - start) / BENCH_SWITCHES;
+}
+
+int main()
+{
+    int quantum_usecs[] = {MAIN_QUANTUM, BENCH_QUANTUM};
+    if (uthread_init(quantum_usecs, 2) != 0)
+    {
+        return 1;
+    }
+    printf("spawn+terminate: %.1f ns\n", benchSpawnTerminate());
+    printf("block+resume:    %.1f ns\n", benchBlockResume());
+    printf("get_quantums:    %.1f ns\n", benchLookup());
+    printf("block switch:    %.1f ns\n", benchSwitch());
+    printf("yield switch:    %.1f ns\n", benchYield());
+    uthread_terminate(0);
+    return 0;
+}
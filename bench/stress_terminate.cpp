@@ -0,0 +1,109 @@
+/*
+ * Stress test of terminating threads that run on other workers. BENCH_SLOTS threads loop on
+ * uthread_sleep(1) on BENCH_WORKERS workers, while the main thread terminates a random one of
+ * them and spawns a new one in its slot, BENCH_ROUNDS times (or the count given on the command
+ * line). Every thread knows the generation of its slot it was spawned for, and the main thread
+ * moves the generation on once uthread_terminate returned. A terminated thread may still be
+ * finishing the instructions before the signal that stops it, but it must never return from the
+ * library again, so a thread that sees a newer generation twice kept running after it was
+ * terminated. It also fails if the main thread can not terminate the thread of a slot or spawn a
+ * new one, which happens when a terminated thread released an ID it no longer owned.
+ * It prints the number of such runs and exits with 1 if there was any.
+ *
+ * build: g++ -std=c++11 -O2 -I. bench/stress_terminate.cpp libuthreads.a -o stress_terminate
+ *        -lpthread
+ * run:   ./stress_terminate [rounds]
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+
+#define BENCH_QUANTUM_NSECS 100000
+#define BENCH_WORKERS 4
+#define BENCH_SLOTS 32
+#define BENCH_ROUNDS 20000
+#define BENCH_YIELD_EVERY 8
+#define SLOT_BITS 8
+
+static int tids[BENCH_SLOTS];
+static volatile long generations[BENCH_SLOTS];
+static std::atomic<long> staleRuns(0);
+
+/**
+ * entry point of the sleeping threads
+ * @param arg - the slot of the thread and its generation above SLOT_BITS
+ */
+void sleepThread(void *arg)
+{
+    int slot = (int) ((long) arg & ((1 << SLOT_BITS) - 1));
+    long generation = (long) arg >> SLOT_BITS;
+    int stale = 0;
+    for (;;)
+    {
+        if (generations[slot] != generation && ++stale > 1)
+        {
+            staleRuns++;
+        }
+        uthread_sleep(1);
+    }
+}
+
+/**
+ * spawn the thread of a slot for its current generation
+ * @param slot - the slot
+ * @return true on success, false otherwise
+ */
+static bool spawnSlot(int slot)
+{
+    tids[slot] = uthread_spawn_arg(sleepThread,
+                                   (void *) ((generations[slot] << SLOT_BITS) | slot), 0);
+    return tids[slot] != -1;
+}
+
+int main(int argc, char **argv)
+{
+    long rounds = argc > 1 ? atol(argv[1]) : BENCH_ROUNDS;
+    int64_t quantum_nsecs[] = {BENCH_QUANTUM_NSECS};
+    if (uthread_init_workers(quantum_nsecs, 1, BENCH_WORKERS) != 0)
+    {
+        return 1;
+    }
+    for (int slot = 0; slot < BENCH_SLOTS; ++slot)
+    {
+        if (!spawnSlot(slot))
+        {
+            return 1;
+        }
+    }
+    unsigned int seed = 1;
+    long failures = 0;
+    for (long i = 0; i < rounds; ++i)
+    {
+        int slot = rand_r(&seed) % BENCH_SLOTS;
+        if (uthread_terminate(tids[slot]) != 0)
+        {
+            failures++;
+        }
+        generations[slot] = generations[slot] + 1;
+        if (!spawnSlot(slot))
+        {
+            failures++;
+            break;
+        }
+        if (i % BENCH_YIELD_EVERY == 0)
+        {
+            uthread_yield();
+        }
+    }
+    printf("rounds:           %ld\n", rounds);
+    printf("stale runs:       %ld\n", staleRuns.load());
+    printf("failed calls:     %ld\n", failures);
+    if (staleRuns > 0 || failures > 0)
+    {
+        exit(1);
+    }
+    uthread_terminate(0);
+    return 0;
+}
@@ -1,11 +1,22 @@
 #include "uthreads.h"
+#include "uthreads_ext.h"
 #include "Thread.h"
 #include "Scheduler.h"
-#include <sys/time.h>
+#include "Timer.h"
+#include "Channel.h"
+#include "Tracer.h"
 #include <stdio.h>
+#include <string.h>
 #include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <atomic>
 
-#define MAX_THREAD_NUM 100 /* maximal number of threads */
 #define FAIL -1
 #define SUCCESS 0
 #define EXIT_FAIL 1
@@ -13,520 +24,2696 @@
 #define FAIL_LIB_MSG "thread library error: "
 #define FAIL_SYS_MSG "system error: "
 #define FAIL_INIT_MSG "size or quantum value is non-positive"
+#define FAIL_LEVELS_MSG "too many priority levels"
 #define FAIL_SPAWN_MSG "threads capacity if full"
+#define FAIL_SPAWN_MANY_MSG "no entry point or IDs array, or non-positive count"
 #define FAIL_TID_MSG "ID number does not exists"
-#define FAIL_PR_MSG "new priority is negative"
+#define FAIL_PR_MSG "priority is negative or out of range"
+#define FAIL_STACK_SIZE_MSG "stack size is too small"
+#define FAIL_WORKERS_MSG "number of workers is non-positive or too large"
+#define FAIL_POLICY_MSG "unknown ready queue policy"
+#define FAIL_MAX_THREADS_MSG "threads capacity is non-positive or too large"
 #define MAIN_ID_BLOCK_MSG "can not block main thread"
+#define MAIN_ID_SLEEP_MSG "can not put main thread to sleep"
+#define FAIL_SLEEP_MSG "sleep time is non-positive"
+#define FAIL_WAKE_TIME_MSG "wake time is out of range"
+#define FAIL_RELOCK_MSG "mutex is already locked by the calling thread"
+#define FAIL_NOT_OWNER_MSG "mutex is not locked by the calling thread"
+#define FAIL_BUSY_MSG "synchronization object is in use"
+#define FAIL_SEM_VALUE_MSG "semaphore value is negative"
+#define FAIL_CAPACITY_MSG "channel capacity is negative or too large"
+#define FAIL_CLOSED_MSG "channel is closed"
+#define FAIL_NO_ITEM_MSG "no place to store the received item"
+#define FAIL_JOIN_MSG "can not join main thread, the calling thread or a detached thread"
+#define FAIL_DETACH_MSG "can not detach main thread or a detached thread"
+#define FAIL_TRACE_BUILD_MSG "the library was built without UTHREADS_TRACE"
+#define FAIL_TRACE_CAPACITY_MSG "trace capacity is non-positive or too large"
+#define FAIL_NO_TRACE_MSG "no trace was started"
+#define FAIL_TRACE_WRITE_MSG "can not write the trace file"
+#define FAIL_STACK_MODE_MSG "unknown stack profiling mode"
+#define FAIL_STACK_GUARDS_MSG "stack guards can not be changed while threads have stacks"
+#define FAIL_UNMEASURED_MSG "the stack of the thread is not measured"
+#define FAIL_CLOSURE_SIZE_MSG "closure does not fit in the stack"
 #define ALLOC_MSG "allocation failed"
-#define ERROR_BLOCK_MSG "failed to block signals"
-#define ERROR_UNBLOCK_MSG "failed to unblock signals"
-#define TIMER_ERROR_MSG "setitimer error"
+#define TIMER_ERROR_MSG "timer error"
+#define TIMER_CREATE_ERROR "timer_create error"
 #define SIGACTION_ERROR "sigaction error"
 #define SIGEMPTYSET_ERROR "sigemptyset error"
-#define SIGADDSET_ERROR "sigaddset error"
+#define PTHREAD_CREATE_ERROR "pthread_create error"
+#define REACTOR_CREATE_ERROR "epoll_create error"
+
+#define STACK_POOL_PREWARM 16 /* stacks mapped by uthread_init so the first spawns are cheap */
+
+/* a variable of the kernel thread rather than of the uthread. initial-exec TLS is accessed through
+ * %fs on every access, so a uthread that moved to another worker between two accesses still
+ * touches the variable of the kernel thread it runs on */
+#define KERNEL_THREAD_LOCAL thread_local __attribute__((tls_model("initial-exec")))
 
 struct sigaction sa;
-struct itimerval timer;
 static Scheduler *scheduler;
-sigset_t set;
 
+/* the worker of the kernel thread, nullptr for kernel threads that do not run uthreads */
+static KERNEL_THREAD_LOCAL Worker *currentWorker = nullptr;
+
+/* the number of workers waiting for a READY thread, and the futex word they wait on. both are
+ * changed under the scheduler lock */
+static int idleWorkers = 0;
+static volatile int wakeupSeq = 0;
+
+/* whether an idle worker waits in epoll_wait rather than on the futex word, so a READY thread has
+ * to interrupt it. at most one idle worker waits there. changed under the scheduler lock */
+static bool idlePoller = false;
+
+/* while threads sleep in uthread_sleep and no worker runs a thread, no quantum ends, so the time
+ * all the workers are idle is counted in quantums of priority 0: when they all became idle, in
+ * CLOCK_MONOTONIC nano-seconds, and the idle time that did not make a whole quantum yet. changed
+ * under the scheduler lock */
+static uint64_t allIdleSince = 0;
+static uint64_t idleNsecsCarry = 0;
+
+/* whether a batch call is making threads READY, and how many idle workers it woke. the workers
+ * are woken together when the batch ends. changed under the scheduler lock */
+static bool inBatch = false;
+static int batchWakeups = 0;
+
+/* the tracer that records the scheduler events while tracing is on, nullptr otherwise, and the
+ * last tracer started, which is kept after tracing stopped for uthread_trace_dump. both are
+ * changed under the scheduler lock */
+static Tracer *activeTracer = nullptr;
+static Tracer *traceBuffer = nullptr;
+
+/* an object that uthread_spawn_closure moves to the top of the stack of a new thread */
+struct StackClosure
+{
+    void (*move)(void *to, void *from);
+    void *from;
+    size_t size;
+    size_t align;
+};
+
+/* why switchThreads() is called - the timer is re-armed only for a switch that did not come from
+ * the timer, or when the quantum changes */
+typedef enum SwitchReasons
+{
+    PREEMPTED, VOLUNTARY, KEEP_QUANTUM
+} SwitchReasons;
+
+/* depth of nested library calls that must not be preempted, and whether a timer tick arrived
+ * while it was positive. both belong to the kernel thread and are only touched by it and its
+ * signal handler */
+static KERNEL_THREAD_LOCAL volatile sig_atomic_t preemptionDisabled = 0;
+static KERNEL_THREAD_LOCAL volatile sig_atomic_t preemptionPending = 0;
+
+/**
+ * record a scheduler event on the calling worker if tracing is on. without UTHREADS_TRACE it
+ * compiles to nothing, and with it, it costs a single branch while tracing is off
+ * @param type - the kind of the event
+ * @param tid - the ID of the thread the event is about
+ * @param detail - the detail of the event, see TraceEvents
+ */
+inline void traceEvent(TraceEvents type, int tid, int detail)
+{
+#ifdef UTHREADS_TRACE
+    if (__builtin_expect(activeTracer != nullptr, 0))
+    {
+        activeTracer->record(type, tid, currentWorker->getIndex(), detail);
+    }
+#else
+    (void) type;
+    (void) tid;
+    (void) detail;
+#endif
+}
+
+/**
+ * record that a thread stops running on the calling worker and which thread runs next, if
+ * tracing is on
+ * @param prev - the thread that stops running
+ * @param next - the thread that runs next, nullptr if the worker goes idle
+ * @param reason - why switchThreads() was called
+ */
+inline void traceSwitch(Thread *prev, Thread *next, SwitchReasons reason)
+{
+#ifdef UTHREADS_TRACE
+    if (__builtin_expect(activeTracer != nullptr, 0))
+    {
+        TraceSwitchOuts out = reason == PREEMPTED ? TRACE_OUT_PREEMPTED : TRACE_OUT_YIELDED;
+        if (prev->getState() == TERMINATED)
+        {
+            out = TRACE_OUT_TERMINATED;
+        }
+        else if (prev->getState() == BLOCKED)
+        {
+            out = TRACE_OUT_BLOCKED;
+        }
+        int worker = currentWorker->getIndex();
+        activeTracer->record(TRACE_SWITCH_OUT, prev->getID(), worker, out);
+        if (next != nullptr)
+        {
+            activeTracer->record(TRACE_DISPATCH, next->getID(), worker, 0);
+        }
+    }
+#else
+    (void) prev;
+    (void) next;
+    (void) reason;
+#endif
+}
+
+
+/**
+ * print a system error and exit, using only async-signal-safe calls so it can be used on the
+ * context switch path (which runs inside the SIGVTALRM handler)
+ * @param msg - the error message
+ */
+void exitSysError(const char *msg)
+{
+    ssize_t ret = write(STDERR_FILENO, FAIL_SYS_MSG, strlen(FAIL_SYS_MSG));
+    ret = write(STDERR_FILENO, msg, strlen(msg));
+    ret = write(STDERR_FILENO, "\n", 1);
+    (void) ret;
+    _exit(EXIT_FAIL);
+}
+
+void switchThreads(SwitchReasons reason);
+
+/**
+ * start a critical section - a timer tick that arrives until the matching enablePreemption() is
+ * only recorded, and the switch it asks for is made when the critical section ends.
+ * with more than one worker the outermost critical section also holds the scheduler lock.
+ * critical sections may nest, but switchThreads() must only be called at depth 1.
+ * a thread that was terminated by a thread of another worker while it waited for the lock never
+ * gets past it, it switches away right there, before the signal of the termination arrives.
+ */
+void disablePreemption()
+{
+    preemptionDisabled = preemptionDisabled + 1;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    if (preemptionDisabled == 1)
+    {
+        scheduler->lock();
+        Thread *running = currentWorker != nullptr ? currentWorker->getRunningThread() : nullptr;
+        if (running != nullptr && running->getState() == TERMINATED)
+        {
+            switchThreads(VOLUNTARY);
+        }
+    }
+}
+
+/**
+ * end a critical section, and make the switch of a timer tick that arrived during it
+ */
+void enablePreemption()
+{
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    while (preemptionDisabled == 1 && preemptionPending)
+    {
+        switchThreads(PREEMPTED);
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+    // the lock is released first, a tick must never find preemption enabled while it is held
+    if (preemptionDisabled == 1)
+    {
+        scheduler->unlock();
+    }
+    preemptionDisabled = preemptionDisabled - 1;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    if (preemptionDisabled == 0 && preemptionPending)
+    {
+        // the tick arrived between the loop and the decrement
+        disablePreemption();
+        enablePreemption();
+    }
+}
+
+/**
+ * set a timer according to the quantum of the next thread that will run
+ * @param quantum - the quantum of the next thread that will run in nanoseconds.
+ * @param expired - true if the previous quantum was ended by the timer
+ */
+void setTimer(int64_t quantum, bool expired)
+{
+    if (!currentWorker->getTimer()->set(quantum, expired))
+    {
+        exitSysError(TIMER_ERROR_MSG);
+    }
+}
+
+/**
+ * @return the time of CLOCK_MONOTONIC in nanoseconds. clock_gettime is async-signal-safe
+ */
+uint64_t monotonicNsecs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * NSECS_PER_SEC + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * @return the time of CLOCK_MONOTONIC in microseconds, the ticks of the wheel of
+ * uthread_sleep_usecs
+ */
+uint64_t monotonicUsecs()
+{
+    return monotonicNsecs() / NSECS_PER_USEC;
+}
+
+/*~~~~~~~~~ handle threads switch ~~~~~~~~~*/
+
+/**
+ * take the next thread that should run on a worker and make it the running thread of the worker
+ * @param worker - the worker, there must be a READY thread
+ * @return the next thread - the first thread of the highest priority level in the ready queue of
+ * the worker, or stolen from another worker if that queue is empty
+ */
+Thread *getNextThread(Worker *worker)
+{
+    Thread *nextToRun = scheduler->popReadyThread(worker->getIndex());
+    nextToRun->setState(RUNNING);
+    worker->setRunningThread(nextToRun);
+    return nextToRun;
+}
+
+/**
+ * wake workers that wait for a READY thread
+ * @param count - the most workers to wake
+ */
+void wakeIdleWorkers(int count)
+{
+    wakeupSeq = wakeupSeq + 1;
+    syscall(SYS_futex, &wakeupSeq, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    if (idlePoller)
+    {
+        scheduler->getReactor()->interrupt();
+    }
+}
+
+/**
+ * wake a worker that waits for a READY thread, if there is one, or count it for the end of the
+ * batch. must be called under the scheduler lock after a thread became READY
+ */
+void wakeIdleWorker()
+{
+    if (idleWorkers > 0 && inBatch)
+    {
+        batchWakeups++;
+    }
+    else if (idleWorkers > 0)
+    {
+        wakeIdleWorkers(1);
+    }
+}
+
+/**
+ * start a batch call, in which the idle workers are woken once for all the threads it makes
+ * READY rather than once for each. must be called inside a critical section
+ */
+void beginBatch()
+{
+    inBatch = true;
+    batchWakeups = 0;
+}
+
+/**
+ * end a batch call and wake the idle workers it counted
+ */
+void endBatch()
+{
+    inBatch = false;
+    if (batchWakeups > 0 && idleWorkers > 0)
+    {
+        wakeIdleWorkers(batchWakeups < idleWorkers ? batchWakeups : idleWorkers);
+    }
+    batchWakeups = 0;
+}
+
+void wakeThreads(ThreadQueue *threads, int reasons);
+void terminateThread(Thread *toDelete, void *exitValue, bool keep);
+
+/**
+ * @return the longest time an idle worker may wait in microseconds so that a thread that sleeps
+ * in uthread_sleep_usecs wakes on time, and a thread that sleeps in uthread_sleep wakes once its
+ * quantums passed while all the workers were idle, -1 if no thread sleeps
+ */
+int64_t idleTimeoutUsecs()
+{
+    int64_t timeoutUsecs = FAIL;
+    TimerWheel *usecsWheel = scheduler->getUsecsWheel();
+    if (!usecsWheel->empty())
+    {
+        uint64_t now = monotonicUsecs();
+        uint64_t next = usecsWheel->nextTick();
+        timeoutUsecs = next > now ? (int64_t) (next - now) : 0;
+    }
+    TimerWheel *quantumsWheel = scheduler->getQuantumsWheel();
+    if (!quantumsWheel->empty())
+    {
+        uint64_t total = (uint64_t) scheduler->getTotalQuantums();
+        uint64_t next = quantumsWheel->nextTick();
+        uint64_t nsecs = next > total ? (next - total) * (uint64_t) scheduler->getQuantum(0) : 0;
+        nsecs = nsecs > idleNsecsCarry ? nsecs - idleNsecsCarry : 0;
+        int64_t usecs = (int64_t) ((nsecs + NSECS_PER_USEC - 1) / NSECS_PER_USEC);
+        timeoutUsecs = timeoutUsecs < 0 || usecs < timeoutUsecs ? usecs : timeoutUsecs;
+    }
+    return timeoutUsecs;
+}
+
+/**
+ * add the quantums of priority 0 that passed since all the workers became idle to the total
+ * quantums, while threads sleep in uthread_sleep. must be called under the scheduler lock by the
+ * first worker that stops being idle
+ */
+void countIdleQuantums()
+{
+    uint64_t now = monotonicNsecs();
+    if (scheduler->getQuantumsWheel()->empty())
+    {
+        idleNsecsCarry = 0;
+    }
+    else
+    {
+        uint64_t quantum = (uint64_t) scheduler->getQuantum(0);
+        uint64_t idle = idleNsecsCarry + (now > allIdleSince ? now - allIdleSince : 0);
+        scheduler->addTotalQuantums((int) (idle / quantum));
+        idleNsecsCarry = idle % quantum;
+    }
+    allIdleSince = now;
+}
+
+/**
+ * wait until wakeIdleWorker() is called. must be called by an idle worker under the scheduler
+ * lock, which is released while it waits
+ */
+void waitForWork()
+{
+    idleWorkers++;
+    if (idleWorkers == scheduler->getWorkersCount())
+    {
+        allIdleSince = monotonicNsecs();
+    }
+    int seq = wakeupSeq;
+    // a thread that sleeps in uthread_sleep_usecs must wake on time even if no worker switches
+    int64_t timeoutUsecs = idleTimeoutUsecs();
+    Reactor *reactor = scheduler->getReactor();
+    if (reactor->hasWaiters() && !idlePoller)
+    {
+        // while threads wait for file descriptors one idle worker waits for them instead
+        idlePoller = true;
+        int timeoutMsecs = -1;
+        if (timeoutUsecs >= 0)
+        {
+            int64_t msecs = (timeoutUsecs + USECS_PER_MSEC - 1) / USECS_PER_MSEC;
+            timeoutMsecs = msecs > INT_MAX ? INT_MAX : (int) msecs;
+        }
+        struct epoll_event events[REACTOR_EVENTS];
+        scheduler->unlock();
+        int count = reactor->wait(events, REACTOR_EVENTS, timeoutMsecs);
+        scheduler->lock();
+        idlePoller = false;
+        ThreadQueue ready;
+        reactor->dispatch(events, count, &ready);
+        wakeThreads(&ready, WAIT_IO);
+    }
+    else
+    {
+        struct timespec timeout;
+        struct timespec *wakeUpIn = nullptr;
+        if (timeoutUsecs >= 0)
+        {
+            timeout.tv_sec = (time_t) (timeoutUsecs / USECS_PER_SEC);
+            timeout.tv_nsec = (long) (timeoutUsecs % USECS_PER_SEC) * NSECS_PER_USEC;
+            wakeUpIn = &timeout;
+        }
+        scheduler->unlock();
+        syscall(SYS_futex, &wakeupSeq, FUTEX_WAIT_PRIVATE, seq, wakeUpIn, nullptr, 0);
+        scheduler->lock();
+    }
+    if (idleWorkers == scheduler->getWorkersCount())
+    {
+        countIdleQuantums();
+    }
+    idleWorkers--;
+}
+
+/**
+ * make a thread READY in the ready queue of the calling worker
+ * @param thread - the thread, which must not run on any worker
+ */
+void readyThread(Thread *thread)
+{
+    thread->setState(READY);
+    scheduler->addReadyThreadsQueue(thread, currentWorker->getIndex());
+    wakeIdleWorker();
+}
+
+/**
+ * add reasons a thread waits for, and make it BLOCKED if it was not. a TERMINATED thread stays
+ * TERMINATED, so switchThreads() still releases it
+ * @param thread - the thread, which must not be READY
+ * @param reasons - a combination of the WAIT_ flags
+ */
+void blockThread(Thread *thread, int reasons)
+{
+    traceEvent(TRACE_BLOCK, thread->getID(), reasons);
+    thread->addWaitReasons(reasons);
+    if (thread->getState() != BLOCKED && thread->getState() != TERMINATED)
+    {
+        thread->setState(BLOCKED);
+    }
+}
+
+/**
+ * remove reasons a BLOCKED thread waits for, and make it READY if it does not wait for anything
+ * else. a thread that was blocked by another worker and whose worker did not switch away from it
+ * yet just keeps running
+ * @param thread - the thread
+ * @param reasons - a combination of the WAIT_ flags
+ */
+void wakeThread(Thread *thread, int reasons)
+{
+    thread->removeWaitReasons(reasons);
+    if (thread->getWaitReasons() != 0)
+    {
+        return;
+    }
+    traceEvent(TRACE_RESUME, thread->getID(), reasons);
+    if (scheduler->isOnCPU(thread))
+    {
+        thread->setState(RUNNING);
+    }
+    else
+    {
+        readyThread(thread);
+    }
+}
+
+/**
+ * remove reasons all the threads of a queue wait for, see wakeThread()
+ * @param threads - the queue, which is emptied
+ * @param reasons - a combination of the WAIT_ flags
+ */
+void wakeThreads(ThreadQueue *threads, int reasons)
+{
+    Thread *thread = threads->popFront();
+    while (thread != nullptr)
+    {
+        wakeThread(thread, reasons);
+        thread = threads->popFront();
+    }
+}
+
+/**
+ * make the calling thread wait in the queue of a synchronization object or a thread it joins
+ * until wakeFirst() takes it out. must be called inside a critical section of depth 1
+ * @param queue - the queue
+ */
+void waitInQueue(ThreadQueue *queue)
+{
+    Thread *thread = currentWorker->getRunningThread();
+    queue->pushBack(thread);
+    thread->setWaitQueue(queue);
+    blockThread(thread, WAIT_SYNC);
+    switchThreads(VOLUNTARY);
+}
+
+/**
+ * take the first thread out of the queue of a synchronization object or a thread and wake it
+ * @param queue - the queue, which must not be empty
+ * @return the thread
+ */
+Thread *wakeFirst(ThreadQueue *queue)
+{
+    Thread *thread = queue->popFront();
+    thread->setWaitQueue(nullptr);
+    wakeThread(thread, WAIT_SYNC);
+    return thread;
+}
+
+/**
+ * wake the threads whose sleep ended. it is called on every switch, so a sleep ends at the first
+ * switch after its time. advancing the wheels costs O(1) for every thread that wakes or moves
+ * down a level and nothing for the threads that keep sleeping
+ */
+void wakeSleepingThreads()
+{
+    ThreadQueue expired;
+    scheduler->getQuantumsWheel()->advance((uint64_t) scheduler->getTotalQuantums(), &expired);
+    if (!scheduler->getUsecsWheel()->empty())
+    {
+        scheduler->getUsecsWheel()->advance(monotonicUsecs(), &expired);
+    }
+    wakeThreads(&expired, WAIT_SLEEP);
+}
+
+/**
+ * wake the threads whose file descriptors are ready. it is called on every switch, and makes a
+ * single epoll_wait call that does not wait, only while some thread waits for a file descriptor
+ */
+void wakeIOThreads()
+{
+    Reactor *reactor = scheduler->getReactor();
+    if (reactor->hasWaiters())
+    {
+        ThreadQueue ready;
+        reactor->poll(&ready);
+        wakeThreads(&ready, WAIT_IO);
+    }
+}
+
+/**
+ * make the worker a thread runs on switch threads right away, after the thread was blocked or
+ * terminated by a thread of another worker
+ * @param thread - the thread
+ */
+void preemptWorkerOf(Thread *thread)
+{
+    pid_t kernelTID = scheduler->getWorker(thread->getWorker())->getKernelTID();
+    syscall(SYS_tgkill, getpid(), kernelTID, SIGVTALRM);
+}
+
+/**
+ * set the amount of quantums of the given thread, and the total amount of quantums
+ * @param curRunning - the running thread
+ */
+void setQuantums(Thread *curRunning)
+{
+    scheduler->setTotalQuantums();
+    curRunning->setCountQuantums();
+}
+
+/**
+ * switch between the thread that is currently running on the calling worker and the thread that is
+ * first on its queue.
+ * this function may run inside the signal handler, so it must not allocate memory or call any
+ * function that is not async-signal-safe. threads that terminated are only moved to
+ * _recentlyDeleted here and are released later by reclaimTerminatedThreads().
+ * it is always called inside a critical section of depth 1, and the thread that is switched to
+ * ends that critical section on its own way out: in the handler it was preempted in, in the
+ * library function it called, or in threadStart(). the scheduler lock is handed over the same way,
+ * so no other worker can pick the previous thread before its context is saved.
+ * @param reason - PREEMPTED when the quantum of the running thread ended, VOLUNTARY when it gives
+ * up the CPU, KEEP_QUANTUM when it gives the rest of its quantum to the next thread
+ */
+void switchThreads(SwitchReasons reason)
+{
+    Worker *worker = currentWorker;
+    Thread *prevRunning = worker->getRunningThread();
+    preemptionPending = 0;
+    wakeSleepingThreads();
+    wakeIOThreads();
+
+    //check if the queue is empty
+    if (prevRunning->getState() == RUNNING && !scheduler->hasReadyThreads())
+    {
+        setTimer(prevRunning->getQuantum(), reason == PREEMPTED);
+        setQuantums(prevRunning);
+        return;
+    }
+
+    // if the running thread was terminated:
+    if (prevRunning->getState() == TERMINATED)
+    {
+        scheduler->addRecentlyDeleted(prevRunning);
+    }
+    else if (prevRunning->getState() == RUNNING)        //in case the thread is not blocked
+    {
+        prevRunning->setState(READY);
+        scheduler->addReadyThreadsQueue(prevRunning, worker->getIndex());
+    }
+
+    Context *nextCtx = &worker->idleCtx;
+    Thread *curRunning = nullptr;
+    if (scheduler->hasReadyThreads())
+    {
+        curRunning = getNextThread(worker);
+        if (curRunning == prevRunning && reason != PREEMPTED)
+        {
+            // the policy picked the thread that gave up the CPU again, as CFS does with the one
+            // that ran the least, so it goes on in its quantum like a yield with no READY thread
+            return;
+        }
+        if (reason != KEEP_QUANTUM)
+        {
+            setTimer(curRunning->getQuantum(), reason == PREEMPTED);
+        }
+        setQuantums(curRunning);
+        if (curRunning == prevRunning)
+        {
+            return;
+        }
+        nextCtx = &curRunning->ctx;
+    }
+    else
+    {
+        // the thread stopped and no thread is READY, the worker waits for one in its idle context
+        worker->setRunningThread(nullptr);
+    }
+    if (prevRunning->getState() != TERMINATED)
+    {
+        prevRunning->countSwitch(reason == PREEMPTED && prevRunning->getState() == READY);
+    }
+    traceSwitch(prevRunning, curRunning, reason);
+    contextSwitch(&prevRunning->ctx, nextCtx);
+}
+
+/**
+ * the idle context of a worker. it runs inside a critical section of depth 1 that never ends and
+ * drops the timer ticks that arrive in it. it switches to the next READY thread whenever there is
+ * one, and otherwise waits for one with the scheduler lock released.
+ */
+void workerLoop()
+{
+    Worker *worker = currentWorker;
+    while (true)
+    {
+        preemptionPending = 0;
+        wakeSleepingThreads();
+        wakeIOThreads();
+        if (scheduler->hasReadyThreads())
+        {
+            Thread *next = getNextThread(worker);
+            setTimer(next->getQuantum(), false);
+            setQuantums(next);
+            traceEvent(TRACE_DISPATCH, next->getID(), 0);
+            contextSwitch(&worker->idleCtx, &next->ctx);
+        }
+        else
+        {
+            waitForWork();
+        }
+    }
+}
+
+/**
+ * the start routine of the kernel thread of every worker except the first
+ * @param arg - the worker
+ * @return never returns
+ */
+void *workerStart(void *arg)
+{
+    currentWorker = (Worker *) arg;
+    currentWorker->setKernelTID();
+    disablePreemption();
+    if (!currentWorker->getTimer()->create(SIGVTALRM, true))
+    {
+        exitSysError(TIMER_CREATE_ERROR);
+    }
+    workerLoop();
+    return nullptr;
+}
+
+/**
+ * start the kernel threads of all the workers except the first
+ */
+void startWorkers()
+{
+    for (int i = 1; i < scheduler->getWorkersCount(); ++i)
+    {
+        pthread_t kernelThread;
+        if (pthread_create(&kernelThread, nullptr, workerStart, scheduler->getWorker(i)) != 0)
+        {
+            std::cerr << FAIL_SYS_MSG << PTHREAD_CREATE_ERROR << std::endl;
+            exit(EXIT_FAIL);
+        }
+        pthread_detach(kernelThread);
+    }
+}
+
+/**
+ * the handler function of the virtual timer. a tick that arrives inside a critical section is
+ * deferred to its end, otherwise the running thread is preempted right away.
+ * SA_NODEFER keeps SIGVTALRM unblocked while the handler runs, since the handler may switch to a
+ * thread that never returns through it; a nested tick only finds preemption disabled.
+ * @param sigNum - the signal number
+ */
+void timerHandler(int sigNum)
+{
+    (void) sigNum;
+    if (currentWorker == nullptr)   // a kernel thread of the process that does not run uthreads
+    {
+        return;
+    }
+    if (preemptionDisabled)
+    {
+        preemptionPending = 1;
+        return;
+    }
+    // the switch makes system calls, the preempted thread gets its errno back when it resumes
+    int savedErrno = errno;
+    disablePreemption();
+    switchThreads(PREEMPTED);
+    enablePreemption();
+    errno = savedErrno;
+}
+
+/**
+ * the function every spawned thread starts in. it is reached from contextSwitch() inside
+ * switchThreads(), so it first ends the critical section the switch was made in. returning from
+ * the entry point of the thread exits it like uthread_exit(nullptr), so it can still be joined.
+ */
+void threadStart()
+{
+    Thread *self = currentWorker->getRunningThread();
+    void (*func)(void) = self->getFunc();
+    void (*argFunc)(void *) = self->getArgFunc();
+    void *arg = self->getArg();
+    enablePreemption();
+    if (argFunc != nullptr)
+    {
+        argFunc(arg);
+    }
+    else
+    {
+        func();
+    }
+    uthread_exit(nullptr);
+}
+
+/**
+ * release the threads that terminated themselves. must be called with signals blocked and never
+ * from the signal handler, since it frees memory.
+ */
+void reclaimTerminatedThreads()
+{
+    Thread *toDelete = scheduler->getRecentlyDeleted()->popFront();
+    while (toDelete != nullptr)
+    {
+        delete toDelete;
+        toDelete = scheduler->getRecentlyDeleted()->popFront();
+    }
+}
+
+/**
+ * check signals errors
+ */
+void handleSignals()
+{
+    if (sigemptyset(&sa.sa_mask) == FAIL)
+    {
+        std::cerr << FAIL_SYS_MSG << SIGEMPTYSET_ERROR << std::endl;
+        exit(1);
+    }
+    if (sigaction(SIGVTALRM, &sa, NULL) == FAIL)
+    {
+        std::cerr << FAIL_SYS_MSG << SIGACTION_ERROR << std::endl;
+        exit(1);
+    }
+}
+
+/**
+ * define sa_handler function as timerHandler() and deals whit other signals
+ */
+void initSignalSet()
+{
+    sa.sa_handler = &timerHandler;
+    sa.sa_flags = SA_NODEFER;
+    handleSignals();
+}
+
+/*~~~~~~~~~ argument check ~~~~~~~~~*/
+
+/**
+ * check if a number in the given list is smaller or equal to zero
+ * @param quantums - the list to check in
+ * @param size - the size of the list
+ * @return true if there is a number in the list that is smaller or equal to zero
+ */
+template<typename T>
+bool isNonPositive(const T *quantums, int size)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        if (quantums[i] <= 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * check the quantum list given to uthread_init and print the error if it is not valid
+ * @param quantums - the list to check
+ * @param size - the size of the list
+ * @return true if the list is valid, false otherwise
+ */
+template<typename T>
+bool isValidQuantums(const T *quantums, int size)
+{
+    if (size <= 0 || isNonPositive(quantums, size))
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_INIT_MSG << std::endl;
+        return false;
+    }
+    if (size > MAX_PRIORITY_LEVELS)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_LEVELS_MSG << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*~~~~~~~~~ uthreads library functions ~~~~~~~~~*/
+
+/**
+ * This function initializes the thread library.
+ * You may assume that this function is called before any other thread library
+ * function, and that it is called exactly once. The input to the function is
+ * an array of the length of a quantum in micro-seconds for each priority.
+ * It is an error to call this function with an array containing non-positive integer.
+ * @param quantum_usecs -an array of the length of a quantum in micro-seconds for each priority
+ * @param size- is the size of the array.
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_init(int *quantum_usecs, int size)
+{
+    if (!isValidQuantums(quantum_usecs, size))
+    {
+        return FAIL;
+    }
+    int64_t quantum_nsecs[MAX_PRIORITY_LEVELS];
+    for (int i = 0; i < size; ++i)
+    {
+        quantum_nsecs[i] = (int64_t) quantum_usecs[i] * NSECS_PER_USEC;
+    }
+    return uthread_init_nsecs(quantum_nsecs, size);
+}
+
+/**
+ * This function initializes the thread library like uthread_init, with the length of a quantum
+ * of each priority given in nano-seconds.
+ * @param quantum_nsecs - an array of the length of a quantum in nano-seconds for each priority
+ * @param size - is the size of the array.
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_init_nsecs(const int64_t *quantum_nsecs, int size)
+{
+    return uthread_init_workers(quantum_nsecs, size, 1, UTHREAD_POLICY_PRIORITY);
+}
+
+/**
+ * This function initializes the thread library like uthread_init_nsecs, and runs the threads on
+ * the given number of kernel threads (workers).
+ * @param quantum_nsecs - an array of the length of a quantum in nano-seconds for each priority
+ * @param size - is the size of the array.
+ * @param workers - the number of workers, between 1 and MAX_WORKERS
+ * @param policy - UTHREAD_POLICY_PRIORITY or UTHREAD_POLICY_CFS
+ * @param max_threads - the maximal number of concurrent threads, including the main thread,
+ * between 1 and MAX_THREADS_CAPACITY
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_init_workers(const int64_t *quantum_nsecs, int size, int workers, int policy,
+                         int max_threads)
+{
+    if (!isValidQuantums(quantum_nsecs, size))
+    {
+        return FAIL;
+    }
+    if (workers <= 0 || workers > MAX_WORKERS)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_WORKERS_MSG << std::endl;
+        return FAIL;
+    }
+    if (policy != UTHREAD_POLICY_PRIORITY && policy != UTHREAD_POLICY_CFS)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_POLICY_MSG << std::endl;
+        return FAIL;
+    }
+    if (max_threads <= 0 || max_threads > MAX_THREADS_CAPACITY)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_MAX_THREADS_MSG << std::endl;
+        return FAIL;
+    }
+    CycleClock::calibrate();
+    ReadyPolicies readyPolicy = policy == UTHREAD_POLICY_CFS ? CFS_POLICY : PRIORITY_POLICY;
+    scheduler = new Scheduler(quantum_nsecs, size, workers, readyPolicy, max_threads);
+    currentWorker = scheduler->getWorker(0);
+    currentWorker->setKernelTID();
+    disablePreemption();
+    initSignalSet();
+    if (!currentWorker->getTimer()->create(SIGVTALRM, workers > 1))
+    {
+        std::cerr << FAIL_SYS_MSG << TIMER_CREATE_ERROR << std::endl;
+        exit(EXIT_FAIL);
+    }
+    if (!scheduler->getReactor()->create())
+    {
+        std::cerr << FAIL_SYS_MSG << REACTOR_CREATE_ERROR << std::endl;
+        exit(EXIT_FAIL);
+    }
+    // the main thread keeps the stack of this kernel thread, so its idle context needs its own
+    if (!currentWorker->createIdleContext(workerLoop))
+    {
+        std::cerr << ALLOC_MSG << std::endl;
+        exit(EXIT_FAIL);
+    }
+    scheduler->getStackPool(STACK_SIZE)->prewarm(STACK_POOL_PREWARM);
+    uthread_spawn(nullptr, MAIN_THREAD);
+    currentWorker->setRunningThread(scheduler->getThread(MAIN_THREAD));
+    setTimer(scheduler->getThread(MAIN_THREAD)->getQuantum(), false);
+    // the wheel starts at tick 0, move it to the clock while it is empty
+    ThreadQueue noSleepers;
+    scheduler->getUsecsWheel()->advance(monotonicUsecs(), &noSleepers);
+    startWorkers();
+    enablePreemption();
+    return SUCCESS;
+}
+
+
+/**
+ * check if a priority is one of the levels given to uthread_init
+ * @param priority - the priority to check
+ * @return true if the priority is valid, false otherwise
+ */
+bool isValidPriority(int priority)
+{
+    return priority >= 0 && priority < scheduler->getPriorityLevels();
+}
+
+/**
+ * @param f - the entry point of a thread without an argument, or nullptr
+ * @param argFunc - the entry point of a thread with an argument, or nullptr
+ * @return the key the stack profiler learns the stacks of the thread by
+ */
+void (*entryKey(void (*f)(void), void (*argFunc)(void *)))(void)
+{
+    return argFunc != nullptr ? (void (*)(void)) argFunc : f;
+}
+
+/**
+ * create a thread other than the main thread with its stack, and exit the process if no stack
+ * could be made. must be called inside a critical section
+ * @param tid - a free ID for the thread
+ * @param f - the entry point of a thread without an argument, nullptr if it gets one later
+ * @param priority - the priority of the thread
+ * @param stackSize - the size of the stack of the thread in bytes
+ * @return the thread, which is not READY yet
+ */
+Thread *createThread(int tid, void (*f)(void), int priority, size_t stackSize)
+{
+    Thread *newThread = new Thread(tid, scheduler->getQuantum(priority), priority, f,
+                                   scheduler->getStackPool(stackSize), stackSize,
+                                   scheduler->getStackProfiler()->getMode() != STACK_OFF);
+    if (newThread->getStack() == nullptr)
+    {
+        std::cerr << ALLOC_MSG << std::endl;
+        enablePreemption();
+        exit(EXIT_FAIL);
+    }
+    return newThread;
+}
+
+/**
+ * create a new thread and add it to the end of the READY threads list of its priority
+ * @param f - the entry point of a thread without an argument, nullptr if argFunc is given
+ * @param argFunc - the entry point of a thread with an argument, nullptr if f is given
+ * @param arg - the argument of argFunc, replaced by the moved closure if closure is given
+ * @param priority - the priority of the new thread
+ * @param stackSize - the size of the stack of the new thread in bytes
+ * @param closure - an object to move to the top of the stack of the new thread and pass to
+ * argFunc, nullptr if there is none
+ * @return On success, return the ID of the created thread. On failure, return -1.
+ */
+int spawnThread(void (*f)(void), void (*argFunc)(void *), void *arg, int priority,
+                size_t stackSize, const StackClosure *closure)
+{
+    disablePreemption();
+    reclaimTerminatedThreads();
+    if (!isValidPriority(priority))
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_PR_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    if (stackSize < MIN_STACK_SIZE)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_STACK_SIZE_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    int newID = scheduler->getAvailableID();
+    if (newID == FAIL)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_SPAWN_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    Thread *newThread;
+    if (newID == MAIN_THREAD)   // in case adding main Thread, it keeps running on the process stack
+    {
+        newThread = new Thread(newID, scheduler->getQuantum(priority), priority, f, nullptr,
+                               0, false, RUNNING, 1);
+    }
+    else
+    {
+        stackSize = scheduler->getStackProfiler()->learnedSize(entryKey(f, argFunc), stackSize);
+        if (closure != nullptr &&
+            closure->size + closure->align > StackPool::roundToPages(stackSize) - MIN_STACK_SIZE)
+        {
+            std::cerr << FAIL_LIB_MSG << FAIL_CLOSURE_SIZE_MSG << std::endl;
+            enablePreemption();
+            return FAIL;
+        }
+        newThread = createThread(newID, f, priority, stackSize);
+        if (closure != nullptr)
+        {
+            // constructed before the thread is READY, so no other worker can run it before
+            arg = newThread->reserveStackTop(closure->size, closure->align);
+            closure->move(arg, closure->from);
+        }
+        if (argFunc != nullptr)
+        {
+            newThread->setArgFunc(argFunc, arg);
+        }
+        readyThread(newThread);
+        traceEvent(TRACE_SPAWN, newID, priority);
+    }
+    scheduler->addThreadsTable(newThread);
+    enablePreemption();
+    return newID;
+}
+
+/**
+ * This function creates a new thread, whose entry point is the
+ * function f with the signature void f(void). The thread is added to the end
+ * of the READY threads list of its priority. The uthread_spawn function should fail if it
+ * would cause the number of concurrent threads to exceed the limit
+ * (MAX_THREAD_NUM, or the max_threads given to uthread_init_workers). Each thread should be
+ * allocated with a stack of size STACK_SIZE bytes.
+ * @param f- the entry point of the new thread
+ * @param priority- The priority of the new thread.
+ * @return-On success, return the ID of the created thread.
+ * On failure, return -1.
+ */
+int uthread_spawn(void (*f)(void), int priority)
+{
+    return uthread_spawn_stack(f, priority, STACK_SIZE);
+}
+
+/**
+ * This function creates a new thread like uthread_spawn, but with a stack of stack_size bytes
+ * (rounded up to whole pages) instead of STACK_SIZE. The stack is reserved with mmap and physical
+ * memory is only committed for the pages the thread actually touches.
+ * @param f - the entry point of the new thread
+ * @param priority - The priority of the new thread.
+ * @param stack_size - the size of the stack of the new thread in bytes, at least MIN_STACK_SIZE
+ * @return On success, return the ID of the created thread. On failure, return -1.
+ */
+int uthread_spawn_stack(void (*f)(void), int priority, size_t stack_size)
+{
+    return spawnThread(f, nullptr, nullptr, priority, stack_size, nullptr);
+}
+
+/**
+ * This function creates a new thread like uthread_spawn, whose entry point is the function f
+ * with the signature void f(void *), called with arg.
+ * @param f - the entry point of the new thread
+ * @param arg - the argument f is called with
+ * @param priority - The priority of the new thread.
+ * @return On success, return the ID of the created thread. On failure, return -1.
+ */
+int uthread_spawn_arg(void (*f)(void *), void *arg, int priority)
+{
+    return spawnThread(nullptr, f, arg, priority, STACK_SIZE, nullptr);
+}
+
+/**
+ * This function creates count threads like uthread_spawn_arg, in a single critical section that
+ * wakes the idle workers once. If not all of them can be created, none is.
+ * @param f - the entry point of the new threads
+ * @param args - the argument every thread is called with, or nullptr to call all of them with
+ * nullptr
+ * @param count - the number of threads, positive
+ * @param priority - The priority of the new threads.
+ * @param tids - where to store the IDs of the new threads
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_spawn_many(void (*f)(void *), void *const *args, int count, int priority, int *tids)
+{
+    disablePreemption();
+    reclaimTerminatedThreads();
+    if (f == nullptr || tids == nullptr || count <= 0)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_SPAWN_MANY_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    if (!isValidPriority(priority))
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_PR_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    // checked up front, so every thread is made and none has to be taken back
+    if (scheduler->getAvailableCount() < count)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_SPAWN_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    size_t stackSize = scheduler->getStackProfiler()->learnedSize(entryKey(nullptr, f),
+                                                                  STACK_SIZE);
+    beginBatch();
+    for (int i = 0; i < count; ++i)
+    {
+        int newID = scheduler->getAvailableID();
+        Thread *newThread = createThread(newID, nullptr, priority, stackSize);
+        newThread->setArgFunc(f, args != nullptr ? args[i] : nullptr);
+        readyThread(newThread);
+        traceEvent(TRACE_SPAWN, newID, priority);
+        scheduler->addThreadsTable(newThread);
+        tids[i] = newID;
+    }
+    endBatch();
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * This function creates a new thread like uthread_spawn_arg, and moves an object into the top of
+ * its stack, so that spawning it needs no memory of its own. f is called with the moved object,
+ * and is responsible for destroying it. It is used by the uthread_spawn template for callables.
+ * @param f - the entry point of the new thread
+ * @param move - constructs the object at to from the object at from. it runs inside the library
+ * and must not throw or call the library
+ * @param closure - the object to move
+ * @param size - the size of the object in bytes
+ * @param align - the alignment of the object, a power of two
+ * @param priority - The priority of the new thread.
+ * @return On success, return the ID of the created thread. On failure, return -1.
+ */
+int uthread_spawn_closure(void (*f)(void *), void (*move)(void *to, void *from), void *closure,
+                          size_t size, size_t align, int priority)
+{
+    StackClosure stackClosure = {move, closure, size, align};
+    return spawnThread(nullptr, f, nullptr, priority, STACK_SIZE, &stackClosure);
+}
+
+
+/**
+ * This function changes the priority of the thread with ID tid. If this is the current running
+ * thread, the effect should take place only the
+ * next time the thread gets scheduled. A READY thread is moved to the end of the READY list of
+ * its new priority.
+ * @param tid - thread ID number
+ * @param priority - the new priority
+ * @return On success, return 0. On failure, return -1
+ */
+int uthread_change_priority(int tid, int priority)
+{
+    disablePreemption();
+    Thread *thread = scheduler->getThread(tid);
+    if (thread == nullptr)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    if (!isValidPriority(priority))
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_PR_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    if (thread->getState() == READY)
+    {
+        scheduler->removeFromReadyThreadsQueue(thread);
+        thread->setPriority(priority, scheduler->getQuantum(priority));
+        scheduler->addReadyThreadsQueue(thread, thread->getWorker());
+    }
+    else
+    {
+        thread->setPriority(priority, scheduler->getQuantum(priority));
+    }
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * erase all the threads in ThreadsTable. the running threads of the workers, the caller among
+ * them, may still be running on their stacks, so they are left for the exit of the process to
+ * release
+ */
+void eraseAllThreads()
+{
+    for (int tid = 0; tid < scheduler->getCapacity(); ++tid)
+    {
+        Thread *toDelete = scheduler->getThread(tid);
+        if (toDelete != nullptr && (!scheduler->isOnCPU(toDelete) ||
+                                    toDelete->getStack() == nullptr))
+        {
+            scheduler->removeFromThreadsTable(tid);
+            delete toDelete;
+        }
+    }
+}
+
+/**
+ * terminate the main thread after erasing all the other threads and releasing resources
+ * @return
+ */
+void terminateMainThread()
+{
+    scheduler->clearReadyThreads();
+    scheduler->clearSleepingThreads();
+    scheduler->getReactor()->clear();
+    reclaimTerminatedThreads();
+    eraseAllThreads();
+    activeTracer = nullptr;
+    delete traceBuffer;
+    traceBuffer = nullptr;
+}
+
+/**
+ * wake the threads that join a thread that terminates and hand them its exit value
+ * @param tid - the ID of the thread, which was removed from _threadsTable
+ * @param exitValue - the value the thread exited with
+ * @param keep - true to keep the exit value and the ID for a later join if no thread joins it
+ */
+void releaseJoiners(int tid, void *exitValue, bool keep)
+{
+    ThreadQueue *joiners = scheduler->getJoiners(tid);
+    if (joiners->empty())
+    {
+        if (keep)
+        {
+            scheduler->addZombie(tid, exitValue);
+        }
+        return;
+    }
+    while (!joiners->empty())
+    {
+        Thread *joiner = joiners->front();
+        *joiner->getMessageSlot() = exitValue;
+        joiner->setMessageSlot(nullptr);
+        wakeFirst(joiners);
+    }
+}
+
+/**
+ * remove a thread other than the main thread from all the control structures and release it. a
+ * thread that is still on its stack is only marked TERMINATED, and is released once its worker
+ * switched away from it. must be called inside a critical section of depth 1, and does not return
+ * if the thread is the calling one
+ * @param toDelete - the thread
+ * @param exitValue - the value the threads that join it get
+ * @param keep - true to keep the exit value and the ID for a later join if no thread joins it and
+ * the thread is not detached
+ */
+void terminateThread(Thread *toDelete, void *exitValue, bool keep)
+{
+    int tid = toDelete->getID();
+    traceEvent(TRACE_TERMINATE, tid, 0);
+    if (toDelete->isStackPainted())
+    {
+        scheduler->getStackProfiler()->record(entryKey(toDelete->getFunc(), toDelete->getArgFunc()),
+                                              toDelete->getStackUsage());
+    }
+    scheduler->removeFromThreadsTable(tid);
+    switch (toDelete->getState())
+    {
+        case BLOCKED:
+            if (toDelete->getWaitReasons() & WAIT_SLEEP)
+            {
+                scheduler->removeFromSleeping(toDelete);
+            }
+            if (toDelete->getWaitReasons() & WAIT_IO)
+            {
+                scheduler->getReactor()->removeWaiter(toDelete);
+            }
+            if (toDelete->getWaitReasons() & WAIT_SYNC)
+            {
+                toDelete->getWaitQueue()->remove(toDelete);
+            }
+            break;
+        case READY:
+            scheduler->removeFromReadyThreadsQueue(toDelete);
+            break;
+        default:
+            break;
+    }
+    releaseJoiners(tid, exitValue, keep && !toDelete->isDetached());
+    if (scheduler->isOnCPU(toDelete))
+    {
+        // it is still on its stack, switchThreads() moves it to _recentlyDeleted once its worker
+        // switched away from it, and the next library call returns its stack to the pool
+        toDelete->setState(TERMINATED);
+        if (toDelete == currentWorker->getRunningThread())
+        {
+            switchThreads(VOLUNTARY);
+        }
+        preemptWorkerOf(toDelete);
+    }
+    else
+    {
+        delete toDelete;
+    }
+}
+
+/**
+ * This function terminates the thread with ID tid and deletes
+ * it from all relevant control structures. All the resources allocated by
+ * the library for this thread should be released. If no thread with ID tid
+ * exists it is considered an error. Terminating the main thread
+ * (tid == 0) will result in the termination of the entire process using
+ * exit(0) [after releasing the assigned library memory].
+ * @param tid - ID thread to terminate
+ * @return The function returns 0 if the thread was successfully
+ * terminated and -1 otherwise. If a thread terminates itself or the main
+ * thread is terminated, the function does not return.
+ */
+int uthread_terminate(int tid)
+{
+    disablePreemption();
+    reclaimTerminatedThreads();
+    if (!scheduler->containsKeyThreadsTable(tid))
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    if (tid != MAIN_THREAD)
+    {
+        terminateThread(scheduler->getThread(tid), nullptr, false);
+    }
+    else
+    {
+        // preemption stays disabled, so with more than one worker the other workers stop at their
+        // next switch. the threads are gone and the process is exiting
+        terminateMainThread();
+        exit(SUCCESS);
+    }
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * block a thread until it is resumed, and switch away from it if it is the calling thread
+ * @param thread - the thread, which is not the main thread
+ */
+void blockUserThread(Thread *thread)
+{
+    if (thread == currentWorker->getRunningThread())
+    {
+        blockThread(thread, WAIT_USER);
+        switchThreads(VOLUNTARY);
+    }
+    else if (thread->getState() == RUNNING)     // running on another worker
+    {
+        blockThread(thread, WAIT_USER);
+        preemptWorkerOf(thread);
+    }
+    else if (thread->getState() == READY)
+    {
+        scheduler->removeFromReadyThreadsQueue(thread);
+        blockThread(thread, WAIT_USER);
+    }
+    else
+    {
+        // a sleeping thread stays BLOCKED after its sleep until it is resumed
+        blockThread(thread, WAIT_USER);
+    }
+}
+
+/**
+ * his function blocks the thread with ID tid. The thread may
+ * be resumed later using uthread_resume. If no thread with ID tid exists it
+ * is considered as an error. In addition, it is an error to try blocking the
+ * main thread (tid == 0). If a thread blocks itself, a scheduling decision
+ * should be made. Blocking a thread in BLOCKED state has no
+ * effect and is not considered an error.
+ * @param tid -thread ID
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_block(int tid)
+{
+    disablePreemption();
+    Thread *thread = scheduler->getThread(tid);
+    if (thread == nullptr)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    if (tid == MAIN_THREAD)
+    {
+        std::cerr << FAIL_LIB_MSG << MAIN_ID_BLOCK_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    blockUserThread(thread);
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * This function blocks the threads with the IDs in tids like uthread_block, in a single critical
+ * section. If the calling thread is one of them it is blocked last. If any of the IDs does not
+ * exist or is the main thread, no thread is blocked.
+ * @param tids - the thread IDs
+ * @param count - the number of thread IDs
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_block_many(const int *tids, int count)
+{
+    disablePreemption();
+    for (int i = 0; i < count; ++i)
+    {
+        if (scheduler->getThread(tids[i]) == nullptr)
+        {
+            std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
+            enablePreemption();
+            return FAIL;
+        }
+        if (tids[i] == MAIN_THREAD)
+        {
+            std::cerr << FAIL_LIB_MSG << MAIN_ID_BLOCK_MSG << std::endl;
+            enablePreemption();
+            return FAIL;
+        }
+    }
+    Thread *self = currentWorker->getRunningThread();
+    bool blockSelf = false;
+    for (int i = 0; i < count; ++i)
+    {
+        Thread *thread = scheduler->getThread(tids[i]);
+        if (thread == self)
+        {
+            blockSelf = true;
+        }
+        else
+        {
+            blockUserThread(thread);
+        }
+    }
+    if (blockSelf)
+    {
+        blockUserThread(self);
+    }
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * This function resumes a blocked thread with ID tid and moves
+ * it to the READY state. Resuming a thread in a RUNNING or READY state
+ * has no effect and is not considered as an error. If no thread with
+ * ID tid exists it is considered an error.
+ * @param tid - thread ID
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_resume(int tid)
+{
+    disablePreemption();
+    Thread *thread = scheduler->getThread(tid);
+    if (thread == nullptr)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    if (thread->getState() == BLOCKED)
+    {
+        // a sleeping thread keeps sleeping, and becomes READY when its sleep ends
+        wakeThread(thread, WAIT_USER);
+    }
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * This function resumes the threads with the IDs in tids like uthread_resume, in a single
+ * critical section that wakes the idle workers once. If any of the IDs does not exist, no thread
+ * is resumed.
+ * @param tids - the thread IDs
+ * @param count - the number of thread IDs
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_resume_many(const int *tids, int count)
+{
+    disablePreemption();
+    for (int i = 0; i < count; ++i)
+    {
+        if (scheduler->getThread(tids[i]) == nullptr)
+        {
+            std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
+            enablePreemption();
+            return FAIL;
+        }
+    }
+    beginBatch();
+    for (int i = 0; i < count; ++i)
+    {
+        Thread *thread = scheduler->getThread(tids[i]);
+        if (thread->getState() == BLOCKED)
+        {
+            wakeThread(thread, WAIT_USER);
+        }
+    }
+    endBatch();
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * This function returns the thread ID of the calling thread.
+ * @return -  The ID of the calling thread.
+ */
+int uthread_get_tid()
+{
+    disablePreemption();
+    int tid = currentWorker->getRunningThread()->getID();
+    enablePreemption();
+    return tid;
+}
+
+
+/**
+ * This function returns the total number of quantums since
+ * the library was initialized, including the current quantum.
+ * Right after the call to uthread_init, the value should be 1.
+ * Each time a new quantum starts, regardless of the reason, this number
+ * should be increased by 1.
+ * @return- The total number of quantums.
+ */
+int uthread_get_total_quantums()
+{
+    return scheduler->getTotalQuantums();
+}
+
+
+/**
+ * This function returns the number of quantums the thread with
+ * ID tid was in RUNNING state. On the first time a thread runs, the function
+ * should return 1. Every additional quantum that the thread starts should
+ * increase this value by 1 (so if the thread with ID tid is in RUNNING state
+ * when this function is called, include also the current quantum). If no
+ * thread with ID tid exists it is considered an error.
+ * @param tid - thread ID
+ * @return On success, return the number of quantums of the thread with ID tid.
+ * 			     On failure, return -1.
+ */
+int uthread_get_quantums(int tid)
+{
+    disablePreemption();
+    Thread *thread = scheduler->getThread(tid);
+    if (thread == nullptr)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    int countQuantums = thread->getCountQuantums();
+    enablePreemption();
+    return countQuantums;
+}
+
+/**
+ * This function makes the calling thread give up the CPU. It is moved to the end of the READY
+ * threads list of its priority and the next thread is scheduled, which starts a new quantum. If
+ * there is no other READY thread, or the policy picks the calling thread again, the function
+ * returns right away and the caller goes on in its quantum.
+ * @param keep_quantum - false to give the next thread a full quantum, true to let it run for what
+ * is left of the quantum of the caller without re-arming the timer
+ * @return On success, return 0.
+ */
+int uthread_yield(bool keep_quantum)
+{
+    disablePreemption();
+    if (scheduler->hasReadyThreads())
+    {
+        switchThreads(keep_quantum ? KEEP_QUANTUM : VOLUNTARY);
+    }
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * This function terminates the calling thread like uthread_terminate, with an exit value for the
+ * threads that join it. If no thread joins it yet and it is not detached, its ID and exit value
+ * are kept until one does, and its ID is not given to a new thread until then. Its stack is
+ * released either way. Calling it from the main thread terminates the process like
+ * uthread_terminate(0). A thread that returns from its entry point exits like
+ * uthread_exit(nullptr).
+ * @param ret - the exit value
+ */
+void uthread_exit(void *ret)
+{
+    disablePreemption();
+    reclaimTerminatedThreads();
+    Thread *thread = currentWorker->getRunningThread();
+    if (thread->getID() == MAIN_THREAD)
+    {
+        terminateMainThread();
+        exit(SUCCESS);
+    }
+    terminateThread(thread, ret, true);
+}
+
+/**
+ * This function blocks the calling thread until the thread with ID tid terminates, and then
+ * moves it to the end of the READY threads list of its priority. A thread that terminated with
+ * uthread_exit or returned from its entry point and was not joined yet is joined right away, and
+ * is forgotten after it. If no thread with ID tid exists it is considered an error, and so is
+ * joining the main thread, the calling thread or a detached thread.
+ * @param tid - the ID of the thread to join
+ * @param ret - where to store the exit value of the thread, nullptr if it is not needed. A thread
+ * that was terminated in any other way than uthread_exit exits with nullptr.
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_join(int tid, void **ret)
+{
+    disablePreemption();
+    reclaimTerminatedThreads();
+    Thread *thread = currentWorker->getRunningThread();
+    if (tid == MAIN_THREAD || tid == thread->getID() ||
+        (scheduler->containsKeyThreadsTable(tid) && scheduler->getThread(tid)->isDetached()))
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_JOIN_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    void *exitValue = nullptr;
+    if (scheduler->isZombie(tid))
+    {
+        exitValue = scheduler->removeZombie(tid);
+    }
+    else if (scheduler->containsKeyThreadsTable(tid))
+    {
+        // releaseJoiners() stores the exit value and clears the slot before it wakes the thread
+        thread->setMessageSlot(&exitValue);
+        waitInQueue(scheduler->getJoiners(tid));
+        reclaimTerminatedThreads();
+    }
+    else
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    if (ret != nullptr)
+    {
+        *ret = exitValue;
+    }
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * This function detaches the thread with ID tid, so that its ID is released as soon as it
+ * terminates, also with uthread_exit or by returning from its entry point, and it can not be
+ * joined. A thread that already exited and was not joined yet is forgotten right away, and the
+ * threads that already wait to join it still get its exit value. If no thread with ID tid exists
+ * it is considered an error, and so is detaching the main thread or a detached thread.
+ * @param tid - the ID of the thread to detach
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_detach(int tid)
+{
+    disablePreemption();
+    reclaimTerminatedThreads();
+    if (scheduler->isZombie(tid))
+    {
+        scheduler->removeZombie(tid);
+    }
+    else if (scheduler->containsKeyThreadsTable(tid))
+    {
+        Thread *thread = scheduler->getThread(tid);
+        if (tid == MAIN_THREAD || thread->isDetached())
+        {
+            std::cerr << FAIL_LIB_MSG << FAIL_DETACH_MSG << std::endl;
+            enablePreemption();
+            return FAIL;
+        }
+        thread->setDetached();
+    }
+    else
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * check that the calling thread may sleep for the given time and print the error if not
+ * @param thread - the calling thread
+ * @param time - the time to sleep in any unit
+ * @return true if it may sleep, false otherwise
+ */
+bool isValidSleep(Thread *thread, int64_t time)
+{
+    if (thread->getID() == MAIN_THREAD)
+    {
+        std::cerr << FAIL_LIB_MSG << MAIN_ID_SLEEP_MSG << std::endl;
+        return false;
+    }
+    if (time <= 0)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_SLEEP_MSG << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * This function blocks the calling thread until num_quantums new quantums have started, counted
+ * like uthread_get_total_quantums. Then it is moved to the end of the READY threads list of its
+ * priority. A scheduling decision is made right away. It is an error to put the main thread to
+ * sleep. A sleeping thread that is blocked with uthread_block stays BLOCKED after its sleep until
+ * it is resumed, and resuming a sleeping thread does not end its sleep.
+ * @param num_quantums - the number of quantums to sleep, positive
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_sleep(int num_quantums)
+{
+    disablePreemption();
+    Thread *thread = currentWorker->getRunningThread();
+    if (!isValidSleep(thread, num_quantums))
+    {
+        enablePreemption();
+        return FAIL;
+    }
+    uint64_t wakeTick = (uint64_t) scheduler->getTotalQuantums() + num_quantums;
+    if (!scheduler->getQuantumsWheel()->insert(thread, wakeTick))
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_WAKE_TIME_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    blockThread(thread, WAIT_SLEEP_QUANTUMS);
+    switchThreads(VOLUNTARY);
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * This function blocks the calling thread like uthread_sleep, for at least usecs micro-seconds of
+ * real time. The sleep ends at the first switch of any thread after that time, so it is rounded
+ * up to the quantum of the running threads.
+ * @param usecs - the number of micro-seconds to sleep, positive
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_sleep_usecs(int64_t usecs)
+{
+    disablePreemption();
+    Thread *thread = currentWorker->getRunningThread();
+    if (!isValidSleep(thread, usecs))
+    {
+        enablePreemption();
+        return FAIL;
+    }
+    if (!scheduler->getUsecsWheel()->insert(thread, monotonicUsecs() + (uint64_t) usecs))
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_WAKE_TIME_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    blockThread(thread, WAIT_SLEEP_USECS);
+    switchThreads(VOLUNTARY);
+    enablePreemption();
+    return SUCCESS;
+}
+
+/*~~~~~~~~~ blocking I/O ~~~~~~~~~*/
+
+/**
+ * make a file descriptor non-blocking if it is not
+ * @param fd - the file descriptor
+ * @return true on success, false otherwise with errno set by fcntl
+ */
+bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == FAIL)
+    {
+        return false;
+    }
+    return (flags & O_NONBLOCK) || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != FAIL;
+}
+
+/**
+ * @param ret - the result of a system call on a non-blocking file descriptor
+ * @return true if the call failed since it would block, false otherwise
+ */
+bool wouldBlock(ssize_t ret)
+{
+    return ret == FAIL && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/**
+ * make a system call on a non-blocking file descriptor until it does not fail with EAGAIN. while
+ * it does, the calling thread is BLOCKED in the reactor and the other threads keep running.
+ * @param fd - the file descriptor
+ * @param reason - WAIT_IO_READ or WAIT_IO_WRITE, what the call waits for
+ * @param operation - the system call, which returns -1 and sets errno on failure
+ * @return the result of the last call, with its errno
+ */
+template<typename Operation>
+ssize_t waitForIO(int fd, int reason, Operation operation)
+{
+    if (!setNonBlocking(fd))
+    {
+        return FAIL;
+    }
+    ssize_t ret = operation();
+    while (wouldBlock(ret))
+    {
+        disablePreemption();
+        Reactor *reactor = scheduler->getReactor();
+        bool waited = false;
+        if (reactor->watch(fd))
+        {
+            // made again inside the critical section, since an event that arrived after the first
+            // call may already be taken by a poll that found no thread waiting for it
+            ret = operation();
+            if (wouldBlock(ret))
+            {
+                Thread *thread = currentWorker->getRunningThread();
+                reactor->addWaiter(thread, fd, reason);
+                blockThread(thread, reason);
+                switchThreads(VOLUNTARY);
+                waited = true;
+            }
+        }
+        int savedErrno = errno;
+        enablePreemption();
+        errno = savedErrno;
+        if (!waited)
+        {
+            return ret;
+        }
+        ret = operation();
+    }
+    return ret;
+}
+
+/**
+ * This function reads like read(2), but only the calling thread waits until fd is readable. fd is
+ * made non-blocking.
+ * @param fd - the file descriptor
+ * @param buf - the buffer to read into
+ * @param count - the size of the buffer
+ * @return the number of bytes read, 0 at the end of the file. On failure, return -1 and set errno.
+ */
+ssize_t uthread_read(int fd, void *buf, size_t count)
+{
+    return waitForIO(fd, WAIT_IO_READ, [=]()
+    { return read(fd, buf, count); });
+}
+
+/**
+ * This function writes like write(2), but only the calling thread waits until fd is writable. fd
+ * is made non-blocking. Like write(2) it may write less than count bytes.
+ * @param fd - the file descriptor
+ * @param buf - the bytes to write
+ * @param count - the number of bytes to write
+ * @return the number of bytes written. On failure, return -1 and set errno.
+ */
+ssize_t uthread_write(int fd, const void *buf, size_t count)
+{
+    return waitForIO(fd, WAIT_IO_WRITE, [=]()
+    { return write(fd, buf, count); });
+}
+
+/**
+ * This function accepts a connection like accept(2), but only the calling thread waits until a
+ * connection arrives. sockfd is made non-blocking, the new socket is not.
+ * @param sockfd - the listening socket
+ * @param addr - the address of the peer is stored here, may be nullptr
+ * @param addrlen - the size of addr, updated to the size of the address
+ * @return the new socket. On failure, return -1 and set errno.
+ */
+int uthread_accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen)
+{
+    return (int) waitForIO(sockfd, WAIT_IO_READ, [=]()
+    { return accept(sockfd, addr, addrlen); });
+}
+
+/**
+ * This function connects a socket like connect(2), but only the calling thread waits until the
+ * connection is made. sockfd is made non-blocking.
+ * @param sockfd - the socket
+ * @param addr - the address to connect to
+ * @param addrlen - the size of addr
+ * @return On success, return 0. On failure, return -1 and set errno.
+ */
+int uthread_connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
+{
+    if (!setNonBlocking(sockfd))
+    {
+        return FAIL;
+    }
+    int ret = connect(sockfd, addr, addrlen);
+    if (ret == SUCCESS || (errno != EINPROGRESS && errno != EAGAIN))
+    {
+        return ret;
+    }
+    // connecting again reports whether the connection is still in progress, and EISCONN once it
+    // is made
+    ret = (int) waitForIO(sockfd, WAIT_IO_WRITE, [=]()
+    {
+        int again = connect(sockfd, addr, addrlen);
+        if (again == FAIL && (errno == EALREADY || errno == EINPROGRESS))
+        {
+            errno = EAGAIN;
+        }
+        return again;
+    });
+    if (ret == FAIL && errno == EISCONN)
+    {
+        return SUCCESS;
+    }
+    return ret;
+}
+
+/*~~~~~~~~~ synchronization objects ~~~~~~~~~*/
+
+/**
+ * @param waiters - the wait queue of a synchronization object
+ * @return the ThreadQueue stored in it
+ */
+ThreadQueue *waitQueueOf(uthread_wait_queue_t *waiters)
+{
+    static_assert(sizeof(ThreadQueue) == sizeof(uthread_wait_queue_t),
+                  "uthread_wait_queue_t must hold a ThreadQueue");
+    return reinterpret_cast<ThreadQueue *>(waiters);
+}
+
+/**
+ * This function initializes an unlocked mutex.
+ * @param mutex - the mutex
+ * @return On success, return 0.
+ */
+int uthread_mutex_init(uthread_mutex_t *mutex)
+{
+    mutex->owner = UTHREAD_NO_OWNER;
+    mutex->waiters.head = nullptr;
+    mutex->waiters.tail = nullptr;
+    return SUCCESS;
+}
+
+/**
+ * This function destroys a mutex. It is an error to destroy a locked mutex.
+ * @param mutex - the mutex
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_mutex_destroy(uthread_mutex_t *mutex)
+{
+    disablePreemption();
+    if (mutex->owner != UTHREAD_NO_OWNER)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_BUSY_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * This function locks a mutex, and if it is locked by another thread the calling thread is
+ * BLOCKED until it is unlocked for it. It is an error to lock a mutex the calling thread already
+ * locked. A mutex locked by a thread that is terminated stays locked, also for a later thread
+ * that gets the same ID, which can neither unlock it nor lock it without waiting.
+ * @param mutex - the mutex
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_mutex_lock(uthread_mutex_t *mutex)
+{
+    disablePreemption();
+    int64_t serial = (int64_t) currentWorker->getRunningThread()->getSerial();
+    if (mutex->owner == serial)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_RELOCK_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    if (mutex->owner == UTHREAD_NO_OWNER)
+    {
+        mutex->owner = serial;
+    }
+    else
+    {
+        // uthread_mutex_unlock makes the thread the owner before it wakes it
+        waitInQueue(waitQueueOf(&mutex->waiters));
+    }
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * This function locks a mutex if it is unlocked, without waiting.
+ * @param mutex - the mutex
+ * @return 0 if the mutex was locked by the call, -1 if it is locked already.
+ */
+int uthread_mutex_trylock(uthread_mutex_t *mutex)
+{
+    disablePreemption();
+    int ret = FAIL;
+    if (mutex->owner == UTHREAD_NO_OWNER)
+    {
+        mutex->owner = (int64_t) currentWorker->getRunningThread()->getSerial();
+        ret = SUCCESS;
+    }
+    enablePreemption();
+    return ret;
+}
+
+/**
+ * unlock a mutex the calling thread locked, and lock it for the first thread that waits for it.
+ * must be called inside a critical section
+ * @param mutex - the mutex
+ */
+void releaseMutex(uthread_mutex_t *mutex)
+{
+    ThreadQueue *waiters = waitQueueOf(&mutex->waiters);
+    mutex->owner = waiters->empty() ? UTHREAD_NO_OWNER
+                                    : (int64_t) wakeFirst(waiters)->getSerial();
+}
+
+/**
+ * This function unlocks a mutex. If threads wait for it, it is locked for the first of them and
+ * that thread is moved to the end of the READY threads list of its priority. It is an error to
+ * unlock a mutex the calling thread did not lock.
+ * @param mutex - the mutex
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_mutex_unlock(uthread_mutex_t *mutex)
+{
+    disablePreemption();
+    if (mutex->owner != (int64_t) currentWorker->getRunningThread()->getSerial())
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_NOT_OWNER_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    releaseMutex(mutex);
+    enablePreemption();
+    return SUCCESS;
+}
+
+/**
+ * This function initializes a condition variable.
+ * @param cond - the condition variable
+ * @return On success, return 0.
+ */
+int uthread_cond_init(uthread_cond_t *cond)
+{
+    cond->mutex = nullptr;
+    cond->waiters.head = nullptr;
+    cond->waiters.tail = nullptr;
+    return SUCCESS;
+}
 
 /**
- * block other signals
- * @return 0 if the action succeed, exit from the program otherwise
+ * This function destroys a condition variable. It is an error to destroy a condition variable
+ * threads wait for.
+ * @param cond - the condition variable
+ * @return On success, return 0. On failure, return -1.
  */
-int blockSig()
+int uthread_cond_destroy(uthread_cond_t *cond)
 {
-    if (sigprocmask(SIG_BLOCK, &set, nullptr) == FAIL)
+    disablePreemption();
+    if (!waitQueueOf(&cond->waiters)->empty())
     {
-        std::cerr << FAIL_SYS_MSG << ERROR_BLOCK_MSG << std::endl;
-        exit(EXIT_FAIL);
+        std::cerr << FAIL_LIB_MSG << FAIL_BUSY_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
     }
+    enablePreemption();
     return SUCCESS;
 }
 
 /**
- * unblock the blocked signals
- * @return 0 if the action succeed, exit from the program otherwise
+ * This function unlocks a mutex the calling thread locked and makes it wait for the condition
+ * variable. When it is signaled the thread waits for the mutex, and it returns with the mutex
+ * locked. All the threads that wait for a condition variable at once must use the same mutex.
+ * @param cond - the condition variable
+ * @param mutex - the mutex
+ * @return On success, return 0. On failure, return -1.
  */
-int unblockSig()
+int uthread_cond_wait(uthread_cond_t *cond, uthread_mutex_t *mutex)
 {
-    if (sigprocmask(SIG_UNBLOCK, &set, nullptr) == FAIL)
+    disablePreemption();
+    if (mutex->owner != (int64_t) currentWorker->getRunningThread()->getSerial())
     {
-        std::cerr << FAIL_SYS_MSG << ERROR_UNBLOCK_MSG << std::endl;
-        exit(EXIT_FAIL);
+        std::cerr << FAIL_LIB_MSG << FAIL_NOT_OWNER_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
     }
+    cond->mutex = mutex;
+    releaseMutex(mutex);
+    // uthread_cond_signal moves the thread to the queue of the mutex or makes it the owner
+    waitInQueue(waitQueueOf(&cond->waiters));
+    enablePreemption();
     return SUCCESS;
 }
 
 /**
- * set a timer according to the quantum of the next thread that will run
- * @param quantum - the quantum of the next thread that will run.
+ * move the first thread that waits for a condition variable to its mutex: it becomes the owner
+ * and is woken if the mutex is unlocked, otherwise it keeps waiting in the queue of the mutex
+ * @param cond - the condition variable, threads must wait for it
  */
-void setTimer(int quantum)
+void signalFirst(uthread_cond_t *cond)
 {
-    timer.it_value.tv_sec = quantum / 1000000;        // first time interval, seconds part
-    timer.it_value.tv_usec = quantum % 1000000;        // first time interval, microseconds part
-
-    timer.it_interval.tv_sec = quantum / 1000000;    // following time intervals, seconds part
-    timer.it_interval.tv_usec = quantum % 1000000;    // following time intervals, microseconds part
-    if (setitimer(ITIMER_VIRTUAL, &timer, NULL) == FAIL)
+    uthread_mutex_t *mutex = cond->mutex;
+    ThreadQueue *waiters = waitQueueOf(&cond->waiters);
+    if (mutex->owner == UTHREAD_NO_OWNER)
     {
-        std::cerr << FAIL_SYS_MSG << TIMER_ERROR_MSG << std::endl;
-        exit(EXIT_FAIL);
+        mutex->owner = (int64_t) wakeFirst(waiters)->getSerial();
+    }
+    else
+    {
+        Thread *thread = waiters->popFront();
+        ThreadQueue *mutexWaiters = waitQueueOf(&mutex->waiters);
+        mutexWaiters->pushBack(thread);
+        thread->setWaitQueue(mutexWaiters);
     }
 }
 
-/*~~~~~~~~~ handle threads switch ~~~~~~~~~*/
-
 /**
- * @return the next thread that should run
+ * This function wakes the first thread that waits for the condition variable, if there is one.
+ * The thread is moved to the queue of the mutex rather than woken only to wait for it.
+ * @param cond - the condition variable
+ * @return On success, return 0.
  */
-Thread *getNextThread(Thread *nextToRun)
+int uthread_cond_signal(uthread_cond_t *cond)
 {
-    nextToRun = scheduler->getReadyThreadsQueue()->front();
-    scheduler->removeFromReadyThreadsQueue(nextToRun->getID());
-    nextToRun->setState(RUNNING);
-    scheduler->setRunningThread(nextToRun);
-    return nextToRun;
+    disablePreemption();
+    if (!waitQueueOf(&cond->waiters)->empty())
+    {
+        signalFirst(cond);
+    }
+    enablePreemption();
+    return SUCCESS;
 }
 
 /**
- * set the amount of quantums of the given thread, and the total amount of quantums
- * @param curRunning - the running thread
+ * This function wakes all the threads that wait for the condition variable, in their order.
+ * @param cond - the condition variable
+ * @return On success, return 0.
  */
-void setQuantums(Thread *curRunning)
+int uthread_cond_broadcast(uthread_cond_t *cond)
 {
-    scheduler->setTotalQuantums();
-    curRunning->setCountQuantums();
+    disablePreemption();
+    while (!waitQueueOf(&cond->waiters)->empty())
+    {
+        signalFirst(cond);
+    }
+    enablePreemption();
+    return SUCCESS;
 }
 
 /**
- * the handler function of the virtual timer.
- * switch between the thread that is currently running and the thread that is first on the queue.
+ * This function initializes a semaphore.
+ * @param sem - the semaphore
+ * @param value - the initial value, non-negative
+ * @return On success, return 0. On failure, return -1.
  */
-void switchThreads(int sigNum = 0)
+int uthread_sem_init(uthread_sem_t *sem, int value)
 {
-    blockSig();
-    Thread *curRunning = scheduler->getRunningThread();
-
-    //clear the deleted vector
-    scheduler->getRecentlyDeleted().clear();
-
-    //check if the queue is empty
-    if (scheduler->getReadyThreadsQueue()->empty())
-    {
-        setTimer(curRunning->getQuantum());
-        scheduler->setTotalQuantums();
-        curRunning->setCountQuantums();
-        unblockSig();
-        return;
-    }
-
-    // if the running thread is terminating itself:
-    if (curRunning->getState() == TERMINATED)
+    if (value < 0)
     {
-        scheduler->removeFromThreadsMap(curRunning->getID());
-        scheduler->addRecentlyDeletedVec(curRunning);
+        std::cerr << FAIL_LIB_MSG << FAIL_SEM_VALUE_MSG << std::endl;
+        return FAIL;
     }
+    sem->value = value;
+    sem->waiters.head = nullptr;
+    sem->waiters.tail = nullptr;
+    return SUCCESS;
+}
 
-    else        //in case the thread is running or blocked
+/**
+ * This function destroys a semaphore. It is an error to destroy a semaphore threads wait for.
+ * @param sem - the semaphore
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_sem_destroy(uthread_sem_t *sem)
+{
+    disablePreemption();
+    if (!waitQueueOf(&sem->waiters)->empty())
     {
-        int ret_val = sigsetjmp(curRunning->env, 1);
-        if (ret_val == 1)
-        {
-            unblockSig();
-            return;
-        }
-        if (curRunning->getState() == RUNNING)
-        {
-            curRunning->setState(READY);
-            scheduler->addReadyThreadsQueue(&curRunning);
-        }
+        std::cerr << FAIL_LIB_MSG << FAIL_BUSY_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
     }
-
-    curRunning = getNextThread(curRunning);
-    setTimer(curRunning->getQuantum());
-    setQuantums(curRunning);
-    unblockSig();
-    siglongjmp(curRunning->env, 1);
+    enablePreemption();
+    return SUCCESS;
 }
 
 /**
- * check signals errors
+ * This function decrements a semaphore, and if its value is 0 the calling thread is BLOCKED
+ * until it is posted for it.
+ * @param sem - the semaphore
+ * @return On success, return 0.
  */
-void handleSignals()
+int uthread_sem_wait(uthread_sem_t *sem)
 {
-    if (sigaction(SIGVTALRM, &sa, NULL) == FAIL)
-    {
-        std::cerr << FAIL_SYS_MSG << SIGACTION_ERROR << std::endl;
-        exit(1);
-    }
-    if (sigemptyset(&sa.sa_mask) == FAIL)
-    {
-        std::cerr << FAIL_SYS_MSG << SIGEMPTYSET_ERROR << std::endl;
-        exit(1);
-    }
-    if (sigemptyset(&set) == FAIL)
+    disablePreemption();
+    if (sem->value > 0)
     {
-        std::cerr << FAIL_SYS_MSG << SIGEMPTYSET_ERROR << std::endl;
-        exit(1);
+        sem->value--;
     }
-    if (sigaddset(&set, SIGVTALRM) == FAIL)
+    else
     {
-        std::cerr << FAIL_SYS_MSG << SIGADDSET_ERROR << std::endl;
-        exit(1);
+        // uthread_sem_post hands its increment to the thread instead of adding it to the value
+        waitInQueue(waitQueueOf(&sem->waiters));
     }
+    enablePreemption();
+    return SUCCESS;
 }
 
 /**
- * define sa_handler function as switchThreads() and deals whit other signals
+ * This function increments a semaphore, or if threads wait for it, hands the increment to the
+ * first of them, which is moved to the end of the READY threads list of its priority.
+ * @param sem - the semaphore
+ * @return On success, return 0.
  */
-void initSignalSet()
+int uthread_sem_post(uthread_sem_t *sem)
 {
-    sa.sa_handler = &switchThreads;
-    sa.sa_flags = 0;
-    handleSignals();
+    disablePreemption();
+    ThreadQueue *waiters = waitQueueOf(&sem->waiters);
+    if (waiters->empty())
+    {
+        sem->value++;
+    }
+    else
+    {
+        wakeFirst(waiters);
+    }
+    enablePreemption();
+    return SUCCESS;
 }
 
-/*~~~~~~~~~ argument check ~~~~~~~~~*/
+/*~~~~~~~~~ channels ~~~~~~~~~*/
 
 /**
- * check if a number in the given list is smaller or equal to zero
- * @param quantum_usecs - the list to check in
- * @param size - the size of the list
- * @return true if there is a number in the list that is smaller or equal to zero
+ * This function creates an open channel of pointers.
+ * @param capacity - the number of items the channel holds without a receiver, rounded up to a
+ * power of two. 0 makes every send wait until a receiver takes the item.
+ * @return On success, return the channel. On failure, return nullptr.
  */
-bool isNonPositive(int *quantum_usecs, int size)
+uthread_chan_t *uthread_chan_create(int capacity)
 {
-    for (int i = 0; i < size; ++i)
+    if (capacity < 0 || capacity > MAX_CHANNEL_CAPACITY)
     {
-        if (quantum_usecs[i] <= 0)
-        {
-            return true;
-        }
+        std::cerr << FAIL_LIB_MSG << FAIL_CAPACITY_MSG << std::endl;
+        return nullptr;
     }
-    return false;
+    disablePreemption();
+    Channel *chan = new Channel(capacity);
+    enablePreemption();
+    return chan;
 }
 
-/*~~~~~~~~~ uthreads library functions ~~~~~~~~~*/
-
 /**
- * This function initializes the thread library.
- * You may assume that this function is called before any other thread library
- * function, and that it is called exactly once. The input to the function is
- * an array of the length of a quantum in micro-seconds for each priority.
- * It is an error to call this function with an array containing non-positive integer.
- * @param quantum_usecs -an array of the length of a quantum in micro-seconds for each priority
- * @param size- is the size of the array.
+ * This function destroys a channel. The items left in it are dropped, not freed, since the
+ * library does not own what they point to. It is an error to destroy a channel threads wait for.
+ * @param chan - the channel
  * @return On success, return 0. On failure, return -1.
  */
-int uthread_init(int *quantum_usecs, int size)
+int uthread_chan_destroy(uthread_chan_t *chan)
 {
-    blockSig();
-    if (size <= 0 || isNonPositive(quantum_usecs, size))
+    disablePreemption();
+    if (!chan->getSenders()->empty() || !chan->getReceivers()->empty())
     {
-        std::cerr << FAIL_LIB_MSG << FAIL_INIT_MSG << std::endl;
-        unblockSig();
+        std::cerr << FAIL_LIB_MSG << FAIL_BUSY_MSG << std::endl;
+        enablePreemption();
         return FAIL;
     }
-    initSignalSet();
-    scheduler = new Scheduler(quantum_usecs, size);
-    uthread_spawn(nullptr, MAIN_THREAD);
-    scheduler->setRunningThread((*scheduler->getThreadsMap())[MAIN_THREAD]);
-    setTimer((*scheduler->getThreadsMap())[MAIN_THREAD]->getQuantum());
-    unblockSig();
+    delete chan;
+    enablePreemption();
     return SUCCESS;
 }
 
-
 /**
- * This function creates a new thread, whose entry point is the
- * function f with the signature void f(void). The thread is added to the end
- * of the READY threads list. The uthread_spawn function should fail if it
- * would cause the number of concurrent threads to exceed the limit
- * (MAX_THREAD_NUM). Each thread should be allocated with a stack of size
- * STACK_SIZE bytes.
- * @param f- the entry point of the new thread
- * @param priority- The priority of the new thread.
- * @return-On success, return the ID of the created thread.
- * On failure, return -1.
+ * This function sends an item through a channel. If a thread waits to receive, the item is handed
+ * to it and it is moved to the end of the READY threads list of its priority. Otherwise the item
+ * is added to the channel, and if the channel is full the calling thread is BLOCKED until a
+ * receiver takes the item. It is an error to send through a closed channel.
+ * @param chan - the channel
+ * @param item - the item
+ * @return On success, return 0. On failure, return -1.
  */
-int uthread_spawn(void (*f)(void), int priority)
+int uthread_chan_send(uthread_chan_t *chan, void *item)
 {
-    blockSig();
-    int newID = scheduler->getAvailableID();
-    if (newID == FAIL)
+    disablePreemption();
+    if (chan->isClosed())
     {
-        std::cerr << FAIL_LIB_MSG << FAIL_SPAWN_MSG << std::endl;
-        unblockSig();
+        std::cerr << FAIL_LIB_MSG << FAIL_CLOSED_MSG << std::endl;
+        enablePreemption();
         return FAIL;
     }
-    Thread *newThread;
-    if (newID == MAIN_THREAD)   // in case adding main Thread
+    ThreadQueue *receivers = chan->getReceivers();
+    if (!receivers->empty())
     {
-        newThread = new Thread(newID, scheduler->getQuantum_usecs()[priority], priority, f, RUNNING,
-                               1);
-        if (newThread->getStack() == nullptr)
-        {
-            std::cerr << ALLOC_MSG << std::endl;
-            unblockSig();
-            exit(EXIT_FAIL);
-        }
+        // receivers wait only while the buffer is empty, so the item skips it
+        Thread *receiver = receivers->front();
+        *receiver->getMessageSlot() = item;
+        receiver->setMessageSlot(nullptr);
+        wakeFirst(receivers);
+    }
+    else if (!chan->full())
+    {
+        chan->push(item);
     }
     else
     {
-        newThread = new Thread(newID, scheduler->getQuantum_usecs()[priority], priority, f);
-        if (newThread->getStack() == nullptr)
+        // a receiver takes the item from this frame and clears the slot before it wakes the thread
+        Thread *thread = currentWorker->getRunningThread();
+        thread->setMessageSlot(&item);
+        waitInQueue(chan->getSenders());
+        if (thread->getMessageSlot() != nullptr)
         {
-            std::cerr << ALLOC_MSG << std::endl;
-            unblockSig();
-            exit(EXIT_FAIL);
+            thread->setMessageSlot(nullptr);
+            std::cerr << FAIL_LIB_MSG << FAIL_CLOSED_MSG << std::endl;
+            enablePreemption();
+            return FAIL;
         }
-        scheduler->addReadyThreadsQueue(&newThread);
     }
-    scheduler->addThreadsMap(newThread);
-    unblockSig();
-    return newID;
+    enablePreemption();
+    return SUCCESS;
 }
 
-
 /**
- * This function changes the priority of the thread with ID tid. If this is the current running
- * thread, the effect should take place only the
- * next time the thread gets scheduled.
- * @param tid - thread ID number
- * @param priority - the new priority
- * @return On success, return 0. On failure, return -1
+ * This function receives the first item of a channel. If the channel is empty the calling thread
+ * is BLOCKED until a sender hands it an item. A thread that waits to send is woken when its item
+ * is taken or moved into the room the receive made.
+ * @param chan - the channel
+ * @param item - where to store the item, not nullptr
+ * @return On success, return 0. If the channel is closed and empty or item is nullptr, return -1.
  */
-int uthread_change_priority(int tid, int priority)
+int uthread_chan_recv(uthread_chan_t *chan, void **item)
 {
-    if (!scheduler->containsKeyThreadsMap(tid))
+    disablePreemption();
+    if (item == nullptr)
     {
-        std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
+        std::cerr << FAIL_LIB_MSG << FAIL_NO_ITEM_MSG << std::endl;
+        enablePreemption();
         return FAIL;
     }
-    if (priority < 0)
+    ThreadQueue *senders = chan->getSenders();
+    if (!chan->empty())
     {
-        std::cerr << FAIL_LIB_MSG << FAIL_PR_MSG << std::endl;
+        *item = chan->pop();
+        if (!senders->empty())
+        {
+            Thread *sender = senders->front();
+            chan->push(*sender->getMessageSlot());
+            sender->setMessageSlot(nullptr);
+            wakeFirst(senders);
+        }
+    }
+    else if (!senders->empty())
+    {
+        // a channel without a buffer, the item goes from the sender to the receiver
+        Thread *sender = senders->front();
+        *item = *sender->getMessageSlot();
+        sender->setMessageSlot(nullptr);
+        wakeFirst(senders);
+    }
+    else if (chan->isClosed())
+    {
+        enablePreemption();
         return FAIL;
     }
-    (*scheduler->getThreadsMap())[tid]->setPriority(priority);
+    else
+    {
+        // a sender stores the item and clears the slot before it wakes the thread
+        Thread *thread = currentWorker->getRunningThread();
+        thread->setMessageSlot(item);
+        waitInQueue(chan->getReceivers());
+        if (thread->getMessageSlot() != nullptr)
+        {
+            thread->setMessageSlot(nullptr);
+            enablePreemption();
+            return FAIL;
+        }
+    }
+    enablePreemption();
     return SUCCESS;
 }
 
 /**
- * erase all the threads in ThreadsMap
+ * This function closes a channel. The items in it can still be received, but no item can be sent
+ * to it. The threads that wait to receive from it or to send to it are woken and their calls fail.
+ * It is an error to close a closed channel.
+ * @param chan - the channel
+ * @return On success, return 0. On failure, return -1.
  */
-void eraseAllThreads()
+int uthread_chan_close(uthread_chan_t *chan)
 {
-    auto iter = scheduler->getThreadsMap()->begin();
-    while (iter != scheduler->getThreadsMap()->end())
+    disablePreemption();
+    if (chan->isClosed())
     {
-        delete (*iter).second;
-        (*iter).second = nullptr;
-        ++iter;
+        std::cerr << FAIL_LIB_MSG << FAIL_CLOSED_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    chan->close();
+    // the slots of the woken threads are left set, which tells them the channel was closed
+    while (!chan->getReceivers()->empty())
+    {
+        wakeFirst(chan->getReceivers());
+    }
+    while (!chan->getSenders()->empty())
+    {
+        wakeFirst(chan->getSenders());
     }
+    enablePreemption();
+    return SUCCESS;
 }
 
-/**
- * terminate the main thread after erasing all the other threads and releasing resources
- * @return
- */
-void terminateMainThread()
-{
-    scheduler->getReadyThreadsQueue()->clear();
-    scheduler->getBlockedMap()->clear();
-    scheduler->getRecentlyDeleted().clear();
-    eraseAllThreads();
-    scheduler->getThreadsMap()->clear();
-    sigemptyset(&set);
-}
+/*~~~~~~~~~ statistics ~~~~~~~~~*/
 
 /**
- * This function terminates the thread with ID tid and deletes
- * it from all relevant control structures. All the resources allocated by
- * the library for this thread should be released. If no thread with ID tid
- * exists it is considered an error. Terminating the main thread
- * (tid == 0) will result in the termination of the entire process using
- * exit(0) [after releasing the assigned library memory].
- * @param tid - ID thread to terminate
- * @return The function returns 0 if the thread was successfully
- * terminated and -1 otherwise. If a thread terminates itself or the main
- * thread is terminated, the function does not return.
+ * This function fills the runtime statistics of the thread with ID tid. The time in the current
+ * state of the thread is included up to the call.
+ * @param tid - thread ID
+ * @param stats - where to store the statistics
+ * @return On success, return 0. On failure, return -1.
  */
-int uthread_terminate(int tid)
+int uthread_get_stats(int tid, uthread_stats_t *stats)
 {
-    blockSig();
-    if (!scheduler->containsKeyThreadsMap(tid))
+    disablePreemption();
+    Thread *thread = scheduler->getThread(tid);
+    if (thread == nullptr)
     {
         std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
-        unblockSig();
+        enablePreemption();
         return FAIL;
     }
-    if (tid != MAIN_THREAD)
-    {
-        Thread *toDelete = (*scheduler->getThreadsMap())[tid];
-        switch ((*scheduler->getThreadsMap())[tid]->getState())
-        {
-            case RUNNING:
-                (*scheduler->getThreadsMap())[tid]->setState(TERMINATED);
-                switchThreads();
-                break;
-            case BLOCKED:
-                scheduler->removeFromBlockedThreadsMap(tid);
-                scheduler->removeFromThreadsMap(tid);
-                break;
-            case READY:
-                scheduler->removeFromReadyThreadsQueue(tid);
-                scheduler->removeFromThreadsMap(tid);
-                break;
-        }
-        delete toDelete;
-        toDelete = nullptr;
-    }
-    else
+    ThreadStats threadStats;
+    thread->getStats(&threadStats);
+    enablePreemption();
+    stats->run_nsecs = CycleClock::toNsecs(threadStats.stateTicks[RUNNING]);
+    stats->ready_nsecs = CycleClock::toNsecs(threadStats.stateTicks[READY]);
+    stats->blocked_nsecs = CycleClock::toNsecs(threadStats.stateTicks[BLOCKED]);
+    stats->voluntary_switches = threadStats.voluntarySwitches;
+    stats->involuntary_switches = threadStats.involuntarySwitches;
+    for (int i = 0; i < UTHREAD_WAIT_BUCKETS; ++i)
     {
-        terminateMainThread();
-        unblockSig();
-        exit(SUCCESS);
+        stats->ready_wait_histogram[i] = threadStats.readyWaits[i];
     }
-    unblockSig();
     return SUCCESS;
 }
 
+/*~~~~~~~~~ stack profiling ~~~~~~~~~*/
+
 /**
- * block the thread with the given tid
- * @param tid - ID of the thread
+ * This function sets what is done with the stacks of the threads spawned from now on:
+ * UTHREAD_STACK_OFF leaves them alone, UTHREAD_STACK_MEASURE paints them so their high-water
+ * marks can be measured, and UTHREAD_STACK_LEARN also keeps the peak high-water mark of every
+ * entry function and spawns the following threads of that function with a stack of that peak
+ * plus a margin of 4096 bytes, rounded up to whole pages, if it is smaller than the one they ask
+ * for.
+ * A thread that goes deeper than the threads of its function that terminated before it overflows
+ * its learned stack, so the learning run must cover the deepest paths of every function.
+ * @param mode - UTHREAD_STACK_OFF, UTHREAD_STACK_MEASURE or UTHREAD_STACK_LEARN
+ * @return On success, return 0. On failure, return -1.
  */
-void blockThread(int tid)
+int uthread_stack_profile(int mode)
 {
-    scheduler->addBlockedThreadsMap((*scheduler->getThreadsMap())[tid]);
-    (*scheduler->getThreadsMap())[tid]->setState(BLOCKED);
+    if (mode != UTHREAD_STACK_OFF && mode != UTHREAD_STACK_MEASURE && mode != UTHREAD_STACK_LEARN)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_STACK_MODE_MSG << std::endl;
+        return FAIL;
+    }
+    disablePreemption();
+    scheduler->getStackProfiler()->setMode(mode == UTHREAD_STACK_LEARN ? STACK_LEARN :
+                                           mode == UTHREAD_STACK_MEASURE ? STACK_MEASURE :
+                                                                           STACK_OFF);
+    enablePreemption();
+    return SUCCESS;
 }
 
 /**
- * his function blocks the thread with ID tid. The thread may
- * be resumed later using uthread_resume. If no thread with ID tid exists it
- * is considered as an error. In addition, it is an error to try blocking the
- * main thread (tid == 0). If a thread blocks itself, a scheduling decision
- * should be made. Blocking a thread in BLOCKED state has no
- * effect and is not considered an error.
- * @param tid -thread ID
- * @return On success, return 0. On failure, return -1.
+ * This function returns how many bytes of its stack the thread with ID tid has used so far, the
+ * distance from the top of the stack to the deepest byte that was written. The thread must have
+ * been spawned while stack profiling was on.
+ * @param tid - thread ID
+ * @return On success, return the high-water mark in bytes. On failure, return -1.
  */
-int uthread_block(int tid)
+int64_t uthread_get_stack_usage(int tid)
 {
-    blockSig();
-    if (!scheduler->containsKeyThreadsMap(tid))
+    disablePreemption();
+    Thread *thread = scheduler->getThread(tid);
+    if (thread == nullptr)
     {
         std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
-        unblockSig();
+        enablePreemption();
         return FAIL;
     }
-    if (tid == MAIN_THREAD)
+    if (!thread->isStackPainted())
     {
-        std::cerr << FAIL_LIB_MSG << MAIN_ID_BLOCK_MSG << std::endl;
-        unblockSig();
+        std::cerr << FAIL_LIB_MSG << FAIL_UNMEASURED_MSG << std::endl;
+        enablePreemption();
         return FAIL;
     }
-    if ((*scheduler->getThreadsMap())[tid]->getState() == RUNNING)
-    {
-        blockThread(tid);
-        switchThreads();
-    }
-    else if ((*scheduler->getThreadsMap())[tid]->getState() == READY)
-    {
-        scheduler->removeFromReadyThreadsQueue(tid);
-        blockThread(tid);
-    }
-    unblockSig();
-    return SUCCESS;
+    int64_t usage = (int64_t) thread->getStackUsage();
+    enablePreemption();
+    return usage;
 }
 
 /**
- * return thread to the readyQueue and set it's state to READY
- * @param tid - ID of thread to resume
+ * This function fills the high-water marks of all the measured threads: the ones that terminated
+ * and the ones that are still alive, whose stacks are scanned.
+ * @param summary - where to store the summary
+ * @return On success, return 0.
  */
-void resumeThread(int tid)
+int uthread_get_stack_summary(uthread_stack_summary_t *summary)
 {
-    (*scheduler->getThreadsMap())[tid]->setState(READY);
-    scheduler->removeFromBlockedThreadsMap(tid);
-    scheduler->addReadyThreadsQueue(&(*scheduler->getThreadsMap())[tid]);
+    disablePreemption();
+    StackProfiler *profiler = scheduler->getStackProfiler();
+    summary->threads = profiler->getRecordedCount();
+    summary->total_bytes = profiler->getRecordedTotal();
+    summary->max_bytes = profiler->getRecordedMax();
+    for (int tid = 0; tid < scheduler->getCapacity(); ++tid)
+    {
+        Thread *thread = scheduler->getThread(tid);
+        if (thread != nullptr && thread->isStackPainted())
+        {
+            uint64_t usage = thread->getStackUsage();
+            summary->threads++;
+            summary->total_bytes += usage;
+            summary->max_bytes = usage > summary->max_bytes ? usage : summary->max_bytes;
+        }
+    }
+    enablePreemption();
+    return SUCCESS;
 }
 
 /**
- * This function resumes a blocked thread with ID tid and moves
- * it to the READY state. Resuming a thread in a RUNNING or READY state
- * has no effect and is not considered as an error. If no thread with
- * ID tid exists it is considered an error.
- * @param tid - thread ID
+ * This function chooses whether the stacks of the threads spawned with at most STACK_SIZE bytes
+ * of stack get a guard page below them. It fails while any spawned thread is alive.
+ * @param enabled - 1 to give every stack a guard page, 0 to map the stacks without them
  * @return On success, return 0. On failure, return -1.
  */
-int uthread_resume(int tid)
+int uthread_stack_guards(int enabled)
 {
-    blockSig();
-    if (!scheduler->containsKeyThreadsMap(tid))
+    disablePreemption();
+    reclaimTerminatedThreads();
+    if (!scheduler->setGuardedStacks(enabled != 0))
     {
-        std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
-        unblockSig();
+        std::cerr << FAIL_LIB_MSG << FAIL_STACK_GUARDS_MSG << std::endl;
+        enablePreemption();
         return FAIL;
     }
-    if ((*scheduler->getThreadsMap())[tid]->getState() == BLOCKED)
-    {
-        resumeThread(tid);
-    }
-    unblockSig();
+    scheduler->getStackPool(STACK_SIZE)->prewarm(STACK_POOL_PREWARM);
+    enablePreemption();
     return SUCCESS;
 }
 
+/*~~~~~~~~~ tracing ~~~~~~~~~*/
+
 /**
- * This function returns the thread ID of the calling thread.
- * @return -  The ID of the calling thread.
+ * This function starts recording scheduler events into a new ring buffer, which replaces the
+ * buffer of the previous trace. When the buffer is full the oldest events are overwritten.
+ * @param capacity - the number of events kept, rounded up to a power of two, between 1 and
+ * MAX_TRACE_CAPACITY
+ * @return On success, return 0. On failure, or if the library was built without UTHREADS_TRACE,
+ * return -1.
  */
-int uthread_get_tid()
+int uthread_trace_start(int capacity)
 {
-    return scheduler->getRunningThread()->getID();
+#ifdef UTHREADS_TRACE
+    if (capacity <= 0 || capacity > MAX_TRACE_CAPACITY)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_TRACE_CAPACITY_MSG << std::endl;
+        return FAIL;
+    }
+    disablePreemption();
+    delete traceBuffer;
+    traceBuffer = new Tracer(capacity);
+    activeTracer = traceBuffer;
+    enablePreemption();
+    return SUCCESS;
+#else
+    (void) capacity;
+    std::cerr << FAIL_LIB_MSG << FAIL_TRACE_BUILD_MSG << std::endl;
+    return FAIL;
+#endif
 }
 
-
 /**
- * This function returns the total number of quantums since
- * the library was initialized, including the current quantum.
- * Right after the call to uthread_init, the value should be 1.
- * Each time a new quantum starts, regardless of the reason, this number
- * should be increased by 1.
- * @return- The total number of quantums.
+ * This function stops recording scheduler events. The recorded events are kept until the next
+ * uthread_trace_start.
+ * @return On success, return 0. If the library was built without UTHREADS_TRACE, return -1.
  */
-int uthread_get_total_quantums()
+int uthread_trace_stop()
 {
-    return scheduler->getTotalQuantums();
+#ifdef UTHREADS_TRACE
+    disablePreemption();
+    activeTracer = nullptr;
+    enablePreemption();
+    return SUCCESS;
+#else
+    std::cerr << FAIL_LIB_MSG << FAIL_TRACE_BUILD_MSG << std::endl;
+    return FAIL;
+#endif
 }
 
-
 /**
- * This function returns the number of quantums the thread with
- * ID tid was in RUNNING state. On the first time a thread runs, the function
- * should return 1. Every additional quantum that the thread starts should
- * increase this value by 1 (so if the thread with ID tid is in RUNNING state
- * when this function is called, include also the current quantum). If no
- * thread with ID tid exists it is considered an error.
- * @param tid - thread ID
- * @return On success, return the number of quantums of the thread with ID tid.
- * 			     On failure, return -1.
+ * This function writes the recorded events, oldest first, to a file as a Chrome trace in the JSON
+ * object format. Every worker is a track on which the threads it ran are slices. Recording pauses
+ * while the file is written, and it must not be called while another thread starts a trace.
+ * @param path - the file to write
+ * @return On success, return 0. On failure, return -1.
  */
-int uthread_get_quantums(int tid)
+int uthread_trace_dump(const char *path)
 {
-    blockSig();
-    if (!scheduler->containsKeyThreadsMap(tid))
+#ifdef UTHREADS_TRACE
+    disablePreemption();
+    Tracer *tracer = traceBuffer;
+    bool recording = activeTracer != nullptr;
+    if (tracer == nullptr)
     {
-        std::cerr << FAIL_LIB_MSG << FAIL_TID_MSG << std::endl;
-        unblockSig();
+        std::cerr << FAIL_LIB_MSG << FAIL_NO_TRACE_MSG << std::endl;
+        enablePreemption();
+        return FAIL;
+    }
+    // the file is written outside the critical section, so the other workers keep running
+    activeTracer = nullptr;
+    enablePreemption();
+    bool written = tracer->dump(path, scheduler->getWorkersCount());
+    disablePreemption();
+    if (recording && traceBuffer == tracer)
+    {
+        activeTracer = tracer;
+    }
+    enablePreemption();
+    if (!written)
+    {
+        std::cerr << FAIL_LIB_MSG << FAIL_TRACE_WRITE_MSG << std::endl;
         return FAIL;
     }
-    unblockSig();
-    return (*scheduler->getThreadsMap())[tid]->getCountQuantums();
+    return SUCCESS;
+#else
+    (void) path;
+    std::cerr << FAIL_LIB_MSG << FAIL_TRACE_BUILD_MSG << std::endl;
+    return FAIL;
+#endif
 }
-
-
-
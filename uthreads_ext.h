@@ -0,0 +1,621 @@
+#ifndef UTHREADS_EXT_H
+#define UTHREADS_EXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "uthreads.h"
+
+/*
+ * Extensions of the uthreads library API. Every function here may be used after uthread_init,
+ * together with the functions of uthreads.h.
+ */
+
+#define MIN_STACK_SIZE 4096 /* smallest stack size accepted by uthread_spawn_stack */
+#define MAX_WORKERS 64 /* maximal number of kernel threads given to uthread_init_workers */
+#define MAX_THREADS_CAPACITY (1 << 24) /* largest max_threads given to uthread_init_workers */
+
+/* the READY list of every worker, chosen by uthread_init_workers */
+#define UTHREAD_POLICY_PRIORITY 0 /* FIFO per priority, a higher priority always runs first */
+#define UTHREAD_POLICY_CFS 2 /* the thread that ran least first, priorities weigh the time it ran */
+
+/**
+ * This function initializes the thread library like uthread_init, with the length of a quantum
+ * of each priority given in nano-seconds.
+ * @param quantum_nsecs - an array of the length of a quantum in nano-seconds for each priority
+ * @param size - is the size of the array.
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_init_nsecs(const int64_t *quantum_nsecs, int size);
+
+/**
+ * This function initializes the thread library like uthread_init_nsecs, and runs the threads on
+ * the given number of kernel threads (workers) instead of only on the calling one. Every worker
+ * has its own READY list and its own timer, which counts the CPU time of its kernel thread.
+ * Threads are added to the READY list of the worker that spawned or resumed them, and a worker
+ * with an empty list takes threads from the lists of the others, so priorities are kept within
+ * a worker but not between workers.
+ * Blocking or terminating a thread that runs on another worker stops it at once with a signal.
+ * A thread may continue on another kernel thread after any switch, so it must not rely on
+ * thread_local variables or errno across switches. The program must be linked with -lpthread,
+ * and the library must not be built with UTHREADS_ITIMER to use more than one worker.
+ * @param quantum_nsecs - an array of the length of a quantum in nano-seconds for each priority
+ * @param size - is the size of the array.
+ * @param workers - the number of workers, between 1 and MAX_WORKERS. with 1 worker and the
+ * default policy the library behaves exactly like after uthread_init_nsecs
+ * @param policy - UTHREAD_POLICY_PRIORITY, or UTHREAD_POLICY_CFS for completely fair
+ * scheduling. With it every thread gets a share of the CPU that grows by 1.25 times with every
+ * level of its priority, and the next thread to run is the one furthest below its share. A thread
+ * that was spawned or slept starts level with the threads that were READY, so it gets no credit
+ * for the time it did not want the CPU.
+ * @param max_threads - the maximal number of concurrent threads, including the main thread,
+ * between 1 and MAX_THREADS_CAPACITY, instead of MAX_THREAD_NUM. The library keeps about 32 bytes
+ * per possible thread, and every thread takes a Thread and a stack as it is spawned. Every stack
+ * has a guard page below it, which costs it a mapping of its own, and the number of mappings of a
+ * process is limited (vm.max_map_count, 65530 by default), so more than about 32000 threads need
+ * uthread_stack_guards(0).
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_init_workers(const int64_t *quantum_nsecs, int size, int workers,
+                         int policy = UTHREAD_POLICY_PRIORITY, int max_threads = MAX_THREAD_NUM);
+
+/**
+ * This function creates a new thread like uthread_spawn, but with a stack of stack_size bytes
+ * (rounded up to whole pages) instead of STACK_SIZE. The stack is reserved with mmap and physical
+ * memory is only committed for the pages the thread actually touches, so large stacks for deep
+ * recursion cost little until they are used.
+ * @param f - the entry point of the new thread
+ * @param priority - The priority of the new thread.
+ * @param stack_size - the size of the stack of the new thread in bytes, at least MIN_STACK_SIZE
+ * @return On success, return the ID of the created thread. On failure, return -1.
+ */
+int uthread_spawn_stack(void (*f)(void), int priority, size_t stack_size);
+
+/**
+ * This function creates a new thread like uthread_spawn, whose entry point is the function f
+ * with the signature void f(void *), called with arg.
+ * @param f - the entry point of the new thread
+ * @param arg - the argument f is called with
+ * @param priority - The priority of the new thread.
+ * @return On success, return the ID of the created thread. On failure, return -1.
+ */
+int uthread_spawn_arg(void (*f)(void *), void *arg, int priority);
+
+/**
+ * This function creates a new thread like uthread_spawn_arg, and moves an object into the top of
+ * its stack, so that spawning it needs no memory of its own. f is called with the moved object,
+ * and is responsible for destroying it. It is used by the uthread_spawn template for callables.
+ * @param f - the entry point of the new thread
+ * @param move - constructs the object at to from the object at from. it runs inside the library
+ * and must not throw or call the library
+ * @param closure - the object to move
+ * @param size - the size of the object in bytes
+ * @param align - the alignment of the object, a power of two
+ * @param priority - The priority of the new thread.
+ * @return On success, return the ID of the created thread. On failure, return -1.
+ */
+int uthread_spawn_closure(void (*f)(void *), void (*move)(void *to, void *from), void *closure,
+                          size_t size, size_t align, int priority);
+
+/**
+ * This function creates a new thread like uthread_spawn, whose entry point is any callable -
+ * a lambda with captures, a function object or a std::function - called without arguments. The
+ * callable is copied, or moved if it is an rvalue, into the top of the stack of the new thread,
+ * so spawning it allocates no memory, and it is destroyed when it returns. A callable that
+ * converts to void (*)(void) is spawned by the uthread_spawn of uthreads.h instead.
+ * The callable takes its size from the stack of the thread and must leave MIN_STACK_SIZE of it,
+ * and its copy or move constructor must not throw or call the library. A thread that is
+ * terminated before its callable returns does not destroy it.
+ * @param callable - the entry point of the new thread
+ * @param priority - The priority of the new thread.
+ * @return On success, return the ID of the created thread. On failure, return -1.
+ */
+template <typename F, typename = typename std::enable_if<
+        !std::is_convertible<F, void (*)(void)>::value>::type>
+int uthread_spawn(F &&callable, int priority)
+{
+    typedef typename std::decay<F>::type Callable;
+    typedef typename std::remove_reference<F>::type Source;
+    struct Closure
+    {
+        static void run(void *closure)
+        {
+            Callable *self = (Callable *) closure;
+            (*self)();
+            self->~Callable();
+        }
+
+        static void move(void *to, void *from)
+        {
+            new (to) Callable(std::forward<F>(*(Source *) from));
+        }
+    };
+    return uthread_spawn_closure(Closure::run, Closure::move, (void *) &callable,
+                                 sizeof(Callable), alignof(Callable), priority);
+}
+
+/* Batches. The following functions do the work of a loop of uthread_spawn_arg, uthread_block or
+ * uthread_resume calls in a single critical section, and the idle workers are woken once for all
+ * the threads a batch makes READY. */
+
+/**
+ * This function creates count threads like uthread_spawn_arg, in a single critical section that
+ * wakes the idle workers once. If not all of them can be created, none is.
+ * @param f - the entry point of the new threads
+ * @param args - the argument every thread is called with, or nullptr to call all of them with
+ * nullptr
+ * @param count - the number of threads, positive
+ * @param priority - The priority of the new threads.
+ * @param tids - where to store the IDs of the new threads
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_spawn_many(void (*f)(void *), void *const *args, int count, int priority, int *tids);
+
+/**
+ * This function blocks the threads with the IDs in tids like uthread_block, in a single critical
+ * section. If the calling thread is one of them it is blocked last. If any of the IDs does not
+ * exist or is the main thread, no thread is blocked.
+ * @param tids - the thread IDs
+ * @param count - the number of thread IDs
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_block_many(const int *tids, int count);
+
+/**
+ * This function resumes the threads with the IDs in tids like uthread_resume, in a single
+ * critical section that wakes the idle workers once. If any of the IDs does not exist, no thread
+ * is resumed.
+ * @param tids - the thread IDs
+ * @param count - the number of thread IDs
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_resume_many(const int *tids, int count);
+
+/**
+ * This function makes the calling thread give up the CPU. It is moved to the end of the READY
+ * threads list of its priority and the next thread is scheduled, which starts a new quantum. If
+ * there is no other READY thread, or the policy picks the calling thread again, the function
+ * returns right away and the caller goes on in its quantum.
+ * @param keep_quantum - false to give the next thread a full quantum, true to let it run for what
+ * is left of the quantum of the caller without re-arming the timer
+ * @return On success, return 0.
+ */
+int uthread_yield(bool keep_quantum = false);
+
+/**
+ * This function terminates the calling thread like uthread_terminate, with an exit value for the
+ * threads that join it. If no thread joins it yet and it is not detached, its ID and exit value
+ * are kept until one does, and its ID is not given to a new thread until then. Its stack is
+ * released either way. Calling it from the main thread terminates the process like
+ * uthread_terminate(0). A thread that returns from its entry point exits like
+ * uthread_exit(nullptr).
+ * @param ret - the exit value
+ */
+void uthread_exit(void *ret);
+
+/**
+ * This function blocks the calling thread until the thread with ID tid terminates, and then
+ * moves it to the end of the READY threads list of its priority. A thread that terminated with
+ * uthread_exit or returned from its entry point and was not joined yet is joined right away, and
+ * is forgotten after it. If no thread with ID tid exists it is considered an error, and so is
+ * joining the main thread, the calling thread or a detached thread.
+ * @param tid - the ID of the thread to join
+ * @param ret - where to store the exit value of the thread, nullptr if it is not needed. A thread
+ * that was terminated in any other way than uthread_exit exits with nullptr.
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_join(int tid, void **ret);
+
+/**
+ * This function detaches the thread with ID tid, so that its ID is released as soon as it
+ * terminates, also with uthread_exit or by returning from its entry point, and it can not be
+ * joined. A thread that already exited and was not joined yet is forgotten right away, and the
+ * threads that already wait to join it still get its exit value. If no thread with ID tid exists
+ * it is considered an error, and so is detaching the main thread or a detached thread.
+ * @param tid - the ID of the thread to detach
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_detach(int tid);
+
+/**
+ * This function blocks the calling thread until num_quantums new quantums have started, counted
+ * like uthread_get_total_quantums. Then it is moved to the end of the READY threads list of its
+ * priority. A scheduling decision is made right away. It is an error to put the main thread to
+ * sleep. A sleeping thread that is blocked with uthread_block stays BLOCKED after its sleep until
+ * it is resumed, and resuming a sleeping thread does not end its sleep.
+ * The sleeping threads are kept in a hierarchical timing wheel, so any number of them costs O(1)
+ * per switch.
+ * @param num_quantums - the number of quantums to sleep, positive
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_sleep(int num_quantums);
+
+/**
+ * This function blocks the calling thread like uthread_sleep, for at least usecs micro-seconds of
+ * real time (CLOCK_MONOTONIC). The sleep ends at the first switch of any thread after that time,
+ * so it is rounded up to the quantum of the running threads.
+ * @param usecs - the number of micro-seconds to sleep, positive
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_sleep_usecs(int64_t usecs);
+
+/* The following functions make a system call on a file descriptor like the function they are
+ * named after, but when it would block only the calling thread waits: it is BLOCKED until the file
+ * descriptor is ready and the other threads keep running. The file descriptor is made
+ * non-blocking. The file descriptors that threads wait for are polled with epoll on every switch
+ * and whenever no thread is READY. A thread that waits for a file descriptor is not woken by
+ * uthread_resume, and stays BLOCKED after the file descriptor is ready if it was blocked with
+ * uthread_block. On failure they return -1 and set errno like the system call. */
+
+/**
+ * This function reads like read(2).
+ * @param fd - the file descriptor
+ * @param buf - the buffer to read into
+ * @param count - the size of the buffer
+ * @return the number of bytes read, 0 at the end of the file. On failure, return -1.
+ */
+ssize_t uthread_read(int fd, void *buf, size_t count);
+
+/**
+ * This function writes like write(2), and like it may write less than count bytes.
+ * @param fd - the file descriptor
+ * @param buf - the bytes to write
+ * @param count - the number of bytes to write
+ * @return the number of bytes written. On failure, return -1.
+ */
+ssize_t uthread_write(int fd, const void *buf, size_t count);
+
+/**
+ * This function accepts a connection like accept(2). The new socket is left blocking.
+ * @param sockfd - the listening socket
+ * @param addr - the address of the peer is stored here, may be nullptr
+ * @param addrlen - the size of addr, updated to the size of the address
+ * @return the new socket. On failure, return -1.
+ */
+int uthread_accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
+
+/**
+ * This function connects a socket like connect(2).
+ * @param sockfd - the socket
+ * @param addr - the address to connect to
+ * @param addrlen - the size of addr
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
+
+/* Synchronization objects. A thread that waits for one is BLOCKED in a FIFO queue inside the
+ * object, and is handed the object directly when it is released, so a contended object costs a
+ * single switch. Since the object is handed over, a thread that releases it and takes it again
+ * while others wait gets it only after them. A thread that waits for an object is not woken by
+ * uthread_resume, and stays BLOCKED after it got the object if it was blocked with uthread_block.
+ * The fields of the objects are private to the library. */
+
+/* the threads that wait for a synchronization object */
+typedef struct uthread_wait_queue_t
+{
+    void *head;
+    void *tail;
+} uthread_wait_queue_t;
+
+typedef struct uthread_mutex_t
+{
+    int64_t owner;
+    uthread_wait_queue_t waiters;
+} uthread_mutex_t;
+
+typedef struct uthread_cond_t
+{
+    uthread_mutex_t *mutex;
+    uthread_wait_queue_t waiters;
+} uthread_cond_t;
+
+typedef struct uthread_sem_t
+{
+    int value;
+    uthread_wait_queue_t waiters;
+} uthread_sem_t;
+
+#define UTHREAD_NO_OWNER -1
+#define UTHREAD_MUTEX_INITIALIZER {UTHREAD_NO_OWNER, {nullptr, nullptr}}
+#define UTHREAD_COND_INITIALIZER {nullptr, {nullptr, nullptr}}
+
+/**
+ * This function initializes an unlocked mutex.
+ * @param mutex - the mutex
+ * @return On success, return 0.
+ */
+int uthread_mutex_init(uthread_mutex_t *mutex);
+
+/**
+ * This function destroys a mutex. It is an error to destroy a locked mutex.
+ * @param mutex - the mutex
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_mutex_destroy(uthread_mutex_t *mutex);
+
+/**
+ * This function locks a mutex, and if it is locked by another thread the calling thread is
+ * BLOCKED until it is unlocked for it. It is an error to lock a mutex the calling thread already
+ * locked. A mutex locked by a thread that is terminated stays locked, also for a later thread
+ * that gets the same ID, which can neither unlock it nor lock it without waiting.
+ * @param mutex - the mutex
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_mutex_lock(uthread_mutex_t *mutex);
+
+/**
+ * This function locks a mutex if it is unlocked, without waiting.
+ * @param mutex - the mutex
+ * @return 0 if the mutex was locked by the call, -1 if it is locked already.
+ */
+int uthread_mutex_trylock(uthread_mutex_t *mutex);
+
+/**
+ * This function unlocks a mutex. If threads wait for it, it is locked for the first of them and
+ * that thread is moved to the end of the READY threads list of its priority. It is an error to
+ * unlock a mutex the calling thread did not lock.
+ * @param mutex - the mutex
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_mutex_unlock(uthread_mutex_t *mutex);
+
+/**
+ * This function initializes a condition variable.
+ * @param cond - the condition variable
+ * @return On success, return 0.
+ */
+int uthread_cond_init(uthread_cond_t *cond);
+
+/**
+ * This function destroys a condition variable. It is an error to destroy a condition variable
+ * threads wait for.
+ * @param cond - the condition variable
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_cond_destroy(uthread_cond_t *cond);
+
+/**
+ * This function unlocks a mutex the calling thread locked and makes it wait for the condition
+ * variable. When it is signaled the thread waits for the mutex, and it returns with the mutex
+ * locked. All the threads that wait for a condition variable at once must use the same mutex.
+ * @param cond - the condition variable
+ * @param mutex - the mutex
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_cond_wait(uthread_cond_t *cond, uthread_mutex_t *mutex);
+
+/**
+ * This function wakes the first thread that waits for the condition variable, if there is one.
+ * The thread is moved to the queue of the mutex rather than woken only to wait for it.
+ * @param cond - the condition variable
+ * @return On success, return 0.
+ */
+int uthread_cond_signal(uthread_cond_t *cond);
+
+/**
+ * This function wakes all the threads that wait for the condition variable, in their order.
+ * @param cond - the condition variable
+ * @return On success, return 0.
+ */
+int uthread_cond_broadcast(uthread_cond_t *cond);
+
+/**
+ * This function initializes a semaphore.
+ * @param sem - the semaphore
+ * @param value - the initial value, non-negative
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_sem_init(uthread_sem_t *sem, int value);
+
+/**
+ * This function destroys a semaphore. It is an error to destroy a semaphore threads wait for.
+ * @param sem - the semaphore
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_sem_destroy(uthread_sem_t *sem);
+
+/**
+ * This function decrements a semaphore, and if its value is 0 the calling thread is BLOCKED
+ * until it is posted for it.
+ * @param sem - the semaphore
+ * @return On success, return 0.
+ */
+int uthread_sem_wait(uthread_sem_t *sem);
+
+/**
+ * This function increments a semaphore, or if threads wait for it, hands the increment to the
+ * first of them, which is moved to the end of the READY threads list of its priority.
+ * @param sem - the semaphore
+ * @return On success, return 0.
+ */
+int uthread_sem_post(uthread_sem_t *sem);
+
+/* Channels of pointers. Only the pointer is passed, the item it points to is never copied. A
+ * channel holds up to its capacity of items in a ring buffer, and a channel of capacity 0 holds
+ * none, so a sender and a receiver meet and the pointer goes from one to the other. A thread that
+ * waits for a channel is BLOCKED in a FIFO queue inside it, and a peer hands it its item directly,
+ * so a waiting sender or receiver is woken with its call already done. A thread that waits for a
+ * channel is not woken by uthread_resume. */
+
+typedef class Channel uthread_chan_t;
+
+/**
+ * This function creates an open channel of pointers.
+ * @param capacity - the number of items the channel holds without a receiver, rounded up to a
+ * power of two. 0 makes every send wait until a receiver takes the item.
+ * @return On success, return the channel. On failure, return nullptr.
+ */
+uthread_chan_t *uthread_chan_create(int capacity);
+
+/**
+ * This function destroys a channel. The items left in it are dropped, not freed, since the
+ * library does not own what they point to. It is an error to destroy a channel threads wait for.
+ * @param chan - the channel
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_chan_destroy(uthread_chan_t *chan);
+
+/**
+ * This function sends an item through a channel. If a thread waits to receive, the item is handed
+ * to it and it is moved to the end of the READY threads list of its priority. Otherwise the item
+ * is added to the channel, and if the channel is full the calling thread is BLOCKED until a
+ * receiver takes the item. It is an error to send through a closed channel.
+ * @param chan - the channel
+ * @param item - the item
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_chan_send(uthread_chan_t *chan, void *item);
+
+/**
+ * This function receives the first item of a channel. If the channel is empty the calling thread
+ * is BLOCKED until a sender hands it an item. A thread that waits to send is woken when its item
+ * is taken or moved into the room the receive made.
+ * @param chan - the channel
+ * @param item - where to store the item, not nullptr
+ * @return On success, return 0. If the channel is closed and empty or item is nullptr, return -1.
+ */
+int uthread_chan_recv(uthread_chan_t *chan, void **item);
+
+/**
+ * This function closes a channel. The items in it can still be received, but no item can be sent
+ * to it. The threads that wait to receive from it or to send to it are woken and their calls fail.
+ * It is an error to close a closed channel.
+ * @param chan - the channel
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_chan_close(uthread_chan_t *chan);
+
+/* Statistics. Every thread accounts the time it spends in each state, the switches away from it
+ * and how long it waited in the ready queue before each dispatch, at the cost of a read of the
+ * time stamp counter on every change of its state. */
+
+#define UTHREAD_WAIT_BUCKETS 24 /* buckets of the histogram of the ready-queue waits */
+
+/**
+ * The runtime statistics of a thread. Bucket 0 of ready_wait_histogram counts the waits in the
+ * ready queue shorter than 128 nano-seconds, bucket i the waits of [2^(i+6), 2^(i+7))
+ * nano-seconds, and the last bucket also all the longer ones.
+ */
+typedef struct uthread_stats_t
+{
+    uint64_t run_nsecs;             /* time RUNNING */
+    uint64_t ready_nsecs;           /* time READY, waiting to be dispatched */
+    uint64_t blocked_nsecs;         /* time BLOCKED, sleeping or waiting */
+    uint64_t voluntary_switches;    /* switches away after it yielded, blocked or waited */
+    uint64_t involuntary_switches;  /* switches away at the end of its quantum */
+    uint64_t ready_wait_histogram[UTHREAD_WAIT_BUCKETS];
+} uthread_stats_t;
+
+/**
+ * This function fills the runtime statistics of the thread with ID tid. The time in the current
+ * state of the thread is included up to the call.
+ * @param tid - thread ID
+ * @param stats - where to store the statistics
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_get_stats(int tid, uthread_stats_t *stats);
+
+/* Stack profiling. While it is on, the stack of every spawned thread is painted with a pattern
+ * before the thread starts, so how much of it the thread used can be found later by looking for
+ * the deepest byte that is no longer the pattern. Painting commits the whole stack to physical
+ * memory, so it is meant for profiling runs. The high-water mark of a thread includes the frames
+ * of the signal handler that preempted it, if it was preempted at its deepest point. */
+
+#define UTHREAD_STACK_OFF 0     /* stacks are not painted */
+#define UTHREAD_STACK_MEASURE 1 /* stacks are painted and measured */
+#define UTHREAD_STACK_LEARN 2   /* stacks are measured and sized by the peak of their function */
+
+/**
+ * The high-water marks of the stacks of all the measured threads, those that terminated and those
+ * that are alive.
+ */
+typedef struct uthread_stack_summary_t
+{
+    uint64_t threads;       /* measured threads */
+    uint64_t total_bytes;   /* the sum of their high-water marks, for the mean */
+    uint64_t max_bytes;     /* the largest high-water mark */
+} uthread_stack_summary_t;
+
+/**
+ * This function sets what is done with the stacks of the threads spawned from now on:
+ * UTHREAD_STACK_OFF leaves them alone, UTHREAD_STACK_MEASURE paints them so their high-water
+ * marks can be measured, and UTHREAD_STACK_LEARN also keeps the peak high-water mark of every
+ * entry function and spawns the following threads of that function with a stack of that peak
+ * plus a margin of 4096 bytes, rounded up to whole pages, if it is smaller than the one they ask
+ * for.
+ * A thread that goes deeper than the threads of its function that terminated before it overflows
+ * its learned stack, so the learning run must cover the deepest paths of every function.
+ * @param mode - UTHREAD_STACK_OFF, UTHREAD_STACK_MEASURE or UTHREAD_STACK_LEARN
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_stack_profile(int mode);
+
+/**
+ * This function returns how many bytes of its stack the thread with ID tid has used so far, the
+ * distance from the top of the stack to the deepest byte that was written. The thread must have
+ * been spawned while stack profiling was on.
+ * @param tid - thread ID
+ * @return On success, return the high-water mark in bytes. On failure, return -1.
+ */
+int64_t uthread_get_stack_usage(int tid);
+
+/**
+ * This function fills the high-water marks of all the measured threads: the ones that terminated
+ * and the ones that are still alive, whose stacks are scanned.
+ * @param summary - where to store the summary
+ * @return On success, return 0.
+ */
+int uthread_get_stack_summary(uthread_stack_summary_t *summary);
+
+/**
+ * This function chooses whether the stacks of the threads spawned with at most STACK_SIZE bytes
+ * of stack get a guard page below them, so a stack overflow faults at once instead of corrupting
+ * the stack below it. They do by default. Without guard pages the stacks are mapped 64 at a time,
+ * so a process can have far more threads than it can have mappings, and a released stack is kept
+ * for reuse until the library is done. Larger stacks always get a guard page. It fails while any
+ * thread other than the main thread is alive.
+ * @param enabled - 1 to give every stack a guard page, 0 to map the stacks without them
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_stack_guards(int enabled);
+
+/* Tracing. A library built with -DUTHREADS_TRACE can record the scheduler events - spawn,
+ * dispatch, switch out (preempted, yielded, blocked or terminated), block, resume and terminate,
+ * with the ID of the thread, the worker, the time and the reason - in a ring buffer that is
+ * allocated when tracing starts, and write them as a Chrome trace that chrome://tracing and
+ * Perfetto load. While tracing is off an event costs a single branch, and a library built without
+ * the flag records nothing. */
+
+#define MAX_TRACE_CAPACITY (1 << 26) /* most events uthread_trace_start keeps */
+
+/**
+ * This function starts recording scheduler events into a new ring buffer, which replaces the
+ * buffer of the previous trace. When the buffer is full the oldest events are overwritten.
+ * @param capacity - the number of events kept, rounded up to a power of two, between 1 and
+ * MAX_TRACE_CAPACITY
+ * @return On success, return 0. On failure, or if the library was built without UTHREADS_TRACE,
+ * return -1.
+ */
+int uthread_trace_start(int capacity);
+
+/**
+ * This function stops recording scheduler events. The recorded events are kept until the next
+ * uthread_trace_start.
+ * @return On success, return 0. If the library was built without UTHREADS_TRACE, return -1.
+ */
+int uthread_trace_stop();
+
+/**
+ * This function writes the recorded events, oldest first, to a file as a Chrome trace in the JSON
+ * object format. Every worker is a track on which the threads it ran are slices. Recording pauses
+ * while the file is written, and it must not be called while another thread starts a trace.
+ * @param path - the file to write
+ * @return On success, return 0. On failure, return -1.
+ */
+int uthread_trace_dump(const char *path);
+
+#endif